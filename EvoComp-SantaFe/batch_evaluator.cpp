@@ -0,0 +1,354 @@
+/*
+ * batch_evaluator.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batch_evaluator.h"
+#include <algorithm> /* std::copy */
+#include <cstdint> /* SIZE_MAX */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+	defined(_M_IX86)
+#define BATCH_EVALUATOR_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+/* Let the compiler emit AVX2 for `StepAvx2()` alone, whatever -march is. */
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+/** Returns true if the processor and the OS both support AVX2. */
+bool IsAvx2Supported() {
+#if !defined(BATCH_EVALUATOR_AVX2)
+	return false;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	/* AVX, and the OS saving the upper halves of the registers. */
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+		(_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+} /* namespace */
+
+BatchEvaluator::BatchEvaluator(const MapDefinition *map) {
+	row_count_ = static_cast<int32_t>(map->GetRowCount());
+	column_count_ = static_cast<int32_t>(map->GetColumnCount());
+	cell_count_ = row_count_ * column_count_;
+	action_limit_ = static_cast<int32_t>(map->GetActionLimit());
+	north_wrap_ = row_count_ - 1;
+	west_wrap_ = column_count_ - 1;
+	initial_consumed_ =
+		static_cast<int32_t>(map->GetInitialConsumedFoodCount());
+	total_food_ = static_cast<int32_t>(map->GetTotalFoodCount());
+	steps_saved_ = 0;
+	use_avx2_ = IsAvx2Supported();
+
+	pristine_food_.resize(cell_count_);
+	for (int32_t i = 0; i < cell_count_; ++i) {
+		pristine_food_[i] = map->HasUneatenFood(i) ? 1 : 0;
+	}
+	lane_food_.resize(kLaneCount * cell_count_);
+	pass_state_words_ = (static_cast<size_t>(cell_count_) * 4 + 63) / 64;
+	pass_states_.assign(kLaneCount * pass_state_words_, 0);
+	for (size_t lane = 0; lane < kLaneCount; ++lane) {
+		active_[lane] = 0;
+		code_[lane] = nullptr;
+		length_[lane] = 0;
+		pass_eaten_[lane] = 0;
+	}
+}
+std::vector<size_t> BatchEvaluator::Evaluate(std::vector<Program*> programs) {
+	std::vector<size_t> consumed(programs.size());
+	size_t owner[kLaneCount];
+	size_t next = 0;
+	bool running = true;
+
+	steps_saved_ = 0;
+	for (size_t lane = 0; lane < kLaneCount; ++lane) {
+		owner[lane] = SIZE_MAX;
+	}
+	while (running) {
+		/* Retire finished ants and stream in the next programs. */
+		running = false;
+		for (size_t lane = 0; lane < kLaneCount; ++lane) {
+			if (!active_[lane] && owner[lane] != SIZE_MAX) {
+				consumed[owner[lane]] = static_cast<size_t>(eaten_[lane]);
+				steps_saved_ += static_cast<size_t>(action_limit_ -
+													actions_[lane]);
+				owner[lane] = SIZE_MAX;
+			}
+			while (!active_[lane] && next < programs.size()) {
+				const Instruction *code = programs[next]->GetInstructions();
+				size_t length = programs[next]->GetInstructionCount();
+				if (length == 0 || action_limit_ == 0 ||
+					initial_consumed_ >= total_food_) {
+					/* Matches `Program::Run()` never taking an action. */
+					consumed[next++] = static_cast<size_t>(initial_consumed_);
+					steps_saved_ += static_cast<size_t>(action_limit_);
+					continue;
+				}
+				LoadLane(lane, code, length);
+				owner[lane] = next++;
+			}
+			if (active_[lane]) {
+				running = true;
+			}
+		}
+		if (running) {
+			FetchInstructions();
+#if defined(BATCH_EVALUATOR_AVX2)
+			if (use_avx2_) {
+				StepAvx2();
+				continue;
+			}
+#endif
+			StepScalar();
+		}
+	}
+	return consumed;
+}
+size_t BatchEvaluator::GetStepsSaved() {
+	return steps_saved_;
+}
+void BatchEvaluator::LoadLane(size_t lane, const Instruction *code,
+							  size_t length) {
+	std::copy(pristine_food_.begin(), pristine_food_.end(),
+			  lane_food_.begin() + lane * cell_count_);
+	x_[lane] = 0;
+	y_[lane] = 0;
+	direction_[lane] = static_cast<int32_t>(Direction::kEast);
+	actions_[lane] = 0;
+	eaten_[lane] = initial_consumed_;
+	pc_[lane] = 0;
+	active_[lane] = -1;
+	code_[lane] = code;
+	length_[lane] = static_cast<int32_t>(length);
+	for (uint32_t state : pass_state_lists_[lane]) {
+		pass_states_[lane * pass_state_words_ + state / 64] = 0;
+	}
+	pass_state_lists_[lane].clear();
+	pass_eaten_[lane] = eaten_[lane];
+}
+void BatchEvaluator::FetchInstructions() {
+	for (size_t lane = 0; lane < kLaneCount; ++lane) {
+		if (!active_[lane]) {
+			continue;
+		}
+		if (pc_[lane] == length_[lane]) {
+			pc_[lane] = 0;
+		}
+		/* Jumps only go forward, so a zero pc is the start of a pass. */
+		if (pc_[lane] == 0 && IsRepeatingPass(lane)) {
+			active_[lane] = 0;
+			continue;
+		}
+		const Instruction &ins = code_[lane][pc_[lane]];
+		op_[lane] = static_cast<int32_t>(ins.op);
+		target_[lane] = static_cast<int32_t>(ins.target);
+	}
+}
+bool BatchEvaluator::IsRepeatingPass(size_t lane) {
+	uint64_t *states = &pass_states_[lane * pass_state_words_];
+	std::vector<uint32_t> &list = pass_state_lists_[lane];
+
+	/* Eating changes the map, so older states no longer predict anything. */
+	if (eaten_[lane] != pass_eaten_[lane]) {
+		for (uint32_t state : list) {
+			states[state / 64] = 0;
+		}
+		list.clear();
+		pass_eaten_[lane] = eaten_[lane];
+	}
+	uint32_t state = static_cast<uint32_t>(
+		(y_[lane] * column_count_ + x_[lane]) * 4 + direction_[lane]);
+	uint64_t bit = static_cast<uint64_t>(1) << (state % 64);
+	if (states[state / 64] & bit) {
+		return true;
+	}
+	states[state / 64] |= bit;
+	list.push_back(state);
+	return false;
+}
+void BatchEvaluator::StepScalar() {
+	for (size_t lane = 0; lane < kLaneCount; ++lane) {
+		if (!active_[lane]) {
+			continue;
+		}
+		/* Find the cell ahead of the ant. */
+		int32_t row = y_[lane];
+		int32_t column = x_[lane];
+		switch (static_cast<Direction>(direction_[lane])) {
+		case Direction::kNorth:
+			row = (row == 0) ? north_wrap_ : row - 1;
+			break;
+		case Direction::kEast:
+			column = (column + 1 == column_count_) ? 0 : column + 1;
+			break;
+		case Direction::kSouth:
+			row = (row + 1 == row_count_) ? 0 : row + 1;
+			break;
+		case Direction::kWest:
+			column = (column == 0) ? west_wrap_ : column - 1;
+			break;
+		}
+		int32_t &ahead = lane_food_[lane * cell_count_ +
+									row * column_count_ + column];
+
+		switch (static_cast<Opcode>(op_[lane])) {
+		case Opcode::kMoveForward:
+			x_[lane] = column;
+			y_[lane] = row;
+			eaten_[lane] += ahead;
+			ahead = 0;
+			++actions_[lane];
+			++pc_[lane];
+			break;
+		case Opcode::kTurnLeft:
+			direction_[lane] = (direction_[lane] + 3) & 3;
+			++actions_[lane];
+			++pc_[lane];
+			break;
+		case Opcode::kTurnRight:
+			direction_[lane] = (direction_[lane] + 1) & 3;
+			++actions_[lane];
+			++pc_[lane];
+			break;
+		case Opcode::kIfFoodAhead:
+			pc_[lane] = ahead ? pc_[lane] + 1 : target_[lane];
+			break;
+		case Opcode::kJump:
+			pc_[lane] = target_[lane];
+			break;
+		}
+		active_[lane] = (actions_[lane] < action_limit_ &&
+						 eaten_[lane] < total_food_) ? -1 : 0;
+	}
+}
+#if defined(BATCH_EVALUATOR_AVX2)
+TARGET_AVX2 void BatchEvaluator::StepAvx2() {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i three = _mm256_set1_epi32(3);
+	const __m256i lane_base = _mm256_mullo_epi32(
+		_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+		_mm256_set1_epi32(cell_count_));
+	alignas(32) int32_t index[kLaneCount];
+
+	__m256i x = _mm256_load_si256(reinterpret_cast<__m256i*>(x_));
+	__m256i y = _mm256_load_si256(reinterpret_cast<__m256i*>(y_));
+	__m256i dir = _mm256_load_si256(reinterpret_cast<__m256i*>(direction_));
+	__m256i actions = _mm256_load_si256(reinterpret_cast<__m256i*>(actions_));
+	__m256i eaten = _mm256_load_si256(reinterpret_cast<__m256i*>(eaten_));
+	__m256i pc = _mm256_load_si256(reinterpret_cast<__m256i*>(pc_));
+	__m256i active = _mm256_load_si256(reinterpret_cast<__m256i*>(active_));
+	__m256i op = _mm256_load_si256(reinterpret_cast<__m256i*>(op_));
+	__m256i target = _mm256_load_si256(reinterpret_cast<__m256i*>(target_));
+
+	/* Find the cell ahead of every ant.  Masks are -1, so subtracting one
+	 * adds one. */
+	__m256i north = _mm256_cmpeq_epi32(dir, zero);
+	__m256i east = _mm256_cmpeq_epi32(dir, one);
+	__m256i south = _mm256_cmpeq_epi32(dir, _mm256_set1_epi32(2));
+	__m256i west = _mm256_cmpeq_epi32(dir, three);
+	__m256i column = _mm256_sub_epi32(_mm256_add_epi32(x, west), east);
+	__m256i row = _mm256_sub_epi32(_mm256_add_epi32(y, north), south);
+	column = _mm256_blendv_epi8(
+		column, zero,
+		_mm256_cmpeq_epi32(column, _mm256_set1_epi32(column_count_)));
+	column = _mm256_blendv_epi8(
+		column, _mm256_set1_epi32(west_wrap_),
+		_mm256_cmpeq_epi32(column, _mm256_set1_epi32(-1)));
+	row = _mm256_blendv_epi8(
+		row, zero, _mm256_cmpeq_epi32(row, _mm256_set1_epi32(row_count_)));
+	row = _mm256_blendv_epi8(
+		row, _mm256_set1_epi32(north_wrap_),
+		_mm256_cmpeq_epi32(row, _mm256_set1_epi32(-1)));
+	__m256i cell = _mm256_add_epi32(
+		lane_base, _mm256_add_epi32(
+			_mm256_mullo_epi32(row, _mm256_set1_epi32(column_count_)),
+			column));
+	__m256i food = _mm256_mask_i32gather_epi32(zero, lane_food_.data(), cell,
+											   active, 4);
+
+	/* Decode every lane's instruction into masks. */
+	__m256i is_move = _mm256_and_si256(active, _mm256_cmpeq_epi32(op, zero));
+	__m256i is_left = _mm256_and_si256(active, _mm256_cmpeq_epi32(op, one));
+	__m256i is_right = _mm256_and_si256(
+		active, _mm256_cmpeq_epi32(op, _mm256_set1_epi32(2)));
+	__m256i is_if = _mm256_and_si256(active, _mm256_cmpeq_epi32(op, three));
+	__m256i is_jump = _mm256_and_si256(
+		active, _mm256_cmpeq_epi32(op, _mm256_set1_epi32(4)));
+	__m256i terminal = _mm256_or_si256(is_move,
+									   _mm256_or_si256(is_left, is_right));
+
+	/* Apply the terminals. */
+	x = _mm256_blendv_epi8(x, column, is_move);
+	y = _mm256_blendv_epi8(y, row, is_move);
+	__m256i eat = _mm256_and_si256(is_move, food);
+	eaten = _mm256_add_epi32(eaten, eat);
+	dir = _mm256_blendv_epi8(
+		dir, _mm256_and_si256(_mm256_add_epi32(dir, three), three), is_left);
+	dir = _mm256_blendv_epi8(
+		dir, _mm256_and_si256(_mm256_add_epi32(dir, one), three), is_right);
+	actions = _mm256_sub_epi32(actions, terminal);
+
+	/* Advance the program counters. */
+	__m256i taken = _mm256_or_si256(
+		is_jump, _mm256_andnot_si256(_mm256_cmpgt_epi32(food, zero), is_if));
+	__m256i next = _mm256_blendv_epi8(_mm256_add_epi32(pc, one), target, taken);
+	pc = _mm256_blendv_epi8(pc, next, active);
+	active = _mm256_and_si256(
+		active, _mm256_and_si256(
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(action_limit_), actions),
+			_mm256_cmpgt_epi32(_mm256_set1_epi32(total_food_), eaten)));
+
+	_mm256_store_si256(reinterpret_cast<__m256i*>(x_), x);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(y_), y);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(direction_), dir);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(actions_), actions);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(eaten_), eaten);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(pc_), pc);
+	_mm256_store_si256(reinterpret_cast<__m256i*>(active_), active);
+
+	/* There's no scatter in AVX2, but eating is rare enough to not matter. */
+	int eat_mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+		_mm256_cmpgt_epi32(eat, zero)));
+	if (eat_mask) {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(index), cell);
+		for (size_t lane = 0; lane < kLaneCount; ++lane) {
+			if (eat_mask & (1 << lane)) {
+				lane_food_[index[lane]] = 0;
+			}
+		}
+	}
+}
+#endif
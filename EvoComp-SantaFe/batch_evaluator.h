@@ -0,0 +1,140 @@
+/*
+ * batch_evaluator.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Lockstep evaluation of many compiled programs against a single map.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "evaluation_context.h"
+#include "map_definition.h"
+#include "program.h"
+
+/**
+ * @class	BatchEvaluator
+ * Runs a batch of `Program`s against one `MapDefinition` by advancing several
+ * ants at once.  The state of every ant is kept in structure-of-arrays form
+ * so a single step of all lanes is a handful of vector operations: the cell
+ * ahead of each ant is computed with wraparound, the food grid is gathered,
+ * and moves, turns and branches are applied under masks.  When the
+ * processor running the program supports AVX2 the step uses intrinsics,
+ * otherwise a scalar loop over the lanes is used.  Either way the results,
+ * steps saved included, are identical to `Program::Run`.  A lane retires as
+ * soon as its ant runs out of actions, clears the trail or starts a pass
+ * through its program in a state it has started one in before.
+ */
+class BatchEvaluator {
+public:
+	/** Number of ants advanced together. */
+	static const size_t kLaneCount = 8;
+	/**
+	 * Expand the food of a map into the per-cell grid used by the lanes.
+	 *
+	 * @param[in]	*map	The map to evaluate against.
+	 */
+	BatchEvaluator(const MapDefinition *map);
+	/**
+	 * Run every program against the map.  Programs are streamed through the
+	 * lanes, so a lane that finishes early immediately picks up the next
+	 * program instead of idling until the slowest ant is done.
+	 *
+	 * @param[in]	programs	The compiled programs to run.
+	 *
+	 * @return	The consumed food count for each program, in order.
+	 */
+	std::vector<size_t> Evaluate(std::vector<Program*> programs);
+	/**
+	 * Return the number of actions that the ants of the last `Evaluate()`
+	 * call didn't take because they had already eaten all of the food.
+	 */
+	size_t GetStepsSaved();
+private:
+	/**
+	 * Load a program into a lane and reset the lane's ant and food grid.
+	 *
+	 * @param[in]	lane	The lane to load.
+	 * @param[in]	*code	The first instruction of the program.
+	 * @param[in]	length	Number of instructions in the program.
+	 */
+	void LoadLane(size_t lane, const Instruction *code, size_t length);
+	/** Advance every active lane by one instruction (scalar version). */
+	void StepScalar();
+	/**
+	 * Advance every active lane by one instruction (AVX2 version).  Only
+	 * defined when building for x86, and only called if `use_avx2_`.
+	 */
+	void StepAvx2();
+	/**
+	 * Fetch the current instruction of every active lane, retiring the
+	 * lanes that are about to repeat a pass.
+	 */
+	void FetchInstructions();
+	/**
+	 * Record the state of a lane's ant at the start of a pass, the same way
+	 * as `BasicEvaluationContext::IsRepeatingPass()`.
+	 *
+	 * @return	True if the lane started a pass in this state before without
+	 *			eating in between.
+	 */
+	bool IsRepeatingPass(size_t lane);
+
+	int32_t row_count_;
+	int32_t column_count_;
+	int32_t cell_count_;
+	int32_t action_limit_;
+	/**
+	 * Row the ant wraps to when moving north from row zero, and the column
+	 * it wraps to when moving west from column zero, which are always the
+	 * last row and column, matching the geometry of `EvaluationContext`.
+	 */
+	int32_t north_wrap_;
+	int32_t west_wrap_;
+	int32_t initial_consumed_;
+	int32_t total_food_;
+	size_t steps_saved_;
+	bool use_avx2_; /**< The processor supports `StepAvx2()`. */
+	std::vector<int32_t> pristine_food_; /**< One entry per cell. */
+	/** Food grids of every lane laid out one after another. */
+	std::vector<int32_t> lane_food_;
+
+	/* Structure-of-arrays ant state */
+	alignas(32) int32_t x_[kLaneCount];
+	alignas(32) int32_t y_[kLaneCount];
+	alignas(32) int32_t direction_[kLaneCount];
+	alignas(32) int32_t actions_[kLaneCount];
+	alignas(32) int32_t eaten_[kLaneCount];
+	alignas(32) int32_t pc_[kLaneCount];
+	alignas(32) int32_t active_[kLaneCount]; /**< -1 if running, else 0. */
+	/* Current instruction of every lane */
+	alignas(32) int32_t op_[kLaneCount];
+	alignas(32) int32_t target_[kLaneCount];
+	/* The program loaded in every lane */
+	const Instruction *code_[kLaneCount];
+	int32_t length_[kLaneCount];
+	/* Pass states of every lane, one bit per (cell, direction) */
+	size_t pass_state_words_; /**< Words of `pass_states_` per lane. */
+	std::vector<uint64_t> pass_states_;
+	std::vector<uint32_t> pass_state_lists_[kLaneCount]; /**< For clearing. */
+	int32_t pass_eaten_[kLaneCount]; /**< `eaten_` at the last pass. */
+};
@@ -0,0 +1,121 @@
+/*
+ * classic_trails.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "classic_trails.h"
+#include <cstddef>
+
+namespace {
+constexpr size_t kTrailSize = 32;
+/** Copy of maps/muir_map_32x32.dat */
+constexpr const char *kMuirTrail[kTrailSize] = {
+	"_**********_____________________",
+	"__________*_____________________",
+	"__________*_____________________",
+	"__________*_____________________",
+	"__________*_____________________",
+	"****______*____*_________*******",
+	"___*______*_____________*_______",
+	"___*______*_____________*_______",
+	"___*______*___*_________*_______",
+	"___*______*_*___________*_______",
+	"___********_____________*_______",
+	"___________________*****________",
+	"___________*______*_____________",
+	"______________*___*_____________",
+	"__________________*_____________",
+	"_______________*__*_____________",
+	"____________*_____*_____________",
+	"__________________*_____________",
+	"___________*____________________",
+	"________*_______________________",
+	"__________________*_____________",
+	"__________________*_____________",
+	"_______*__________*_____________",
+	"_____*____________*_____________",
+	"__________________*_____________",
+	"____*_____________*_____________",
+	"____*___________________________",
+	"____*___________________________",
+	"____*__****_******______________",
+	"________________________________",
+	"________________________________",
+	"________________________________",
+};
+/** Copy of maps/urbano_map_32x32.dat */
+constexpr const char *kUrbanoTrail[kTrailSize] = {
+	"_***____________________________",
+	"___*____________________________",
+	"___*_____________________***____",
+	"___*____________________*____*__",
+	"___*____________________*____*__",
+	"___****_*****________**_________",
+	"____________*________________*__",
+	"____________*_______*___________",
+	"____________*_______*___________",
+	"____________*_______*________*__",
+	"____________________*___________",
+	"____________*___________________",
+	"____________*________________*__",
+	"____________*_______*___________",
+	"____________*_______*_____***___",
+	"_________________*_____*________",
+	"________________________________",
+	"____________*___________________",
+	"____________*___*_______*_______",
+	"____________*___*__________*____",
+	"____________*___*_______________",
+	"____________*___*_______________",
+	"____________*_____________*_____",
+	"____________*__________*________",
+	"___**__*****____*_______________",
+	"_*______________*_______________",
+	"_*______________*_______________",
+	"_*______*******_________________",
+	"_*_____*________________________",
+	"_______*________________________",
+	"__****__________________________",
+	"________________________________",
+};
+/** Returns the rows of the trail with the given name, or null. */
+const char* const* FindClassicTrail(std::string name) {
+	if (name.compare(0, kClassicTrailPrefix.length(),
+					 kClassicTrailPrefix) != 0) {
+		return nullptr;
+	}
+	name = name.substr(kClassicTrailPrefix.length());
+	if (name == "muir") {
+		return kMuirTrail;
+	} else if (name == "urbano") {
+		return kUrbanoTrail;
+	}
+	return nullptr;
+}
+}
+
+bool IsClassicTrail(std::string name) {
+	return FindClassicTrail(name) != nullptr;
+}
+std::vector<std::string> GetClassicTrail(std::string name) {
+	const char* const *trail = FindClassicTrail(name);
+	if (trail == nullptr) {
+		return std::vector<std::string>();
+	}
+	return std::vector<std::string>(trail, trail + kTrailSize);
+}
@@ -0,0 +1,49 @@
+/*
+ * classic_trails.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * The classic 32x32 trails compiled into the program, so the most common
+ * runs don't depend on the `maps` directory being next to the executable.
+ * An embedded trail is named on the command line as `classic:<name>`, e.g.
+ * `classic:muir`, anywhere a map file is accepted.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+/** Prefix that marks a map name as an embedded trail. */
+const std::string kClassicTrailPrefix = "classic:";
+/**
+ * Returns true if `name` is `kClassicTrailPrefix` followed by the name of
+ * one of the embedded trails.
+ */
+bool IsClassicTrail(std::string name);
+/**
+ * Return the rows of an embedded trail in the same form `ParseDataFile()`
+ * returns the rows of a map file.
+ *
+ * @param[in]	name	Name of the trail, including `kClassicTrailPrefix`.
+ *
+ * @return	One string per row, or an empty vector for an unknown name.
+ */
+std::vector<std::string> GetClassicTrail(std::string name);
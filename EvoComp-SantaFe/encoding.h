@@ -0,0 +1,133 @@
+/*
+ * encoding.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Helpers for the compact binary encoding individuals are sent between
+ * processes in.  Integers are written as little-endian base-128 varints,
+ * and each node of a tree as one byte holding its operator and number of
+ * children, so the encoding doesn't depend on the host or the compiler.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring> /* std::memcpy */
+#include <string>
+#include "operator_types.h"
+
+/** Number of low bits of a node's byte that hold its operator. */
+const unsigned kNodeOperatorBits = 3;
+/** Child count of a node's byte after which a varint has the real count. */
+const size_t kNodeChildEscape = 0xff >> kNodeOperatorBits;
+
+/** Append `value` to `bytes`, seven bits per byte, lowest first. */
+inline void AppendVarint(std::string &bytes, uint64_t value) {
+	while (value >= 0x80) {
+		bytes.push_back(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(static_cast<char>(value));
+}
+/**
+ * Read a varint from `bytes` at `position`, moving `position` past it.
+ *
+ * @return	False if `bytes` ends first or the value overflows.
+ */
+inline bool ReadVarint(const std::string &bytes, size_t &position,
+					   uint64_t &value) {
+	value = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		if (position >= bytes.size()) {
+			return false;
+		}
+		uint8_t byte = static_cast<uint8_t>(bytes[position++]);
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+/** Append the bits of `value`, lowest byte first. */
+inline void AppendDouble(std::string &bytes, double value) {
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	for (size_t i = 0; i < sizeof(bits); ++i) {
+		bytes.push_back(static_cast<char>(bits >> (8 * i)));
+	}
+}
+/**
+ * Read a double written by `AppendDouble()` from `bytes` at `position`,
+ * moving `position` past it.
+ *
+ * @return	False if `bytes` ends first.
+ */
+inline bool ReadDouble(const std::string &bytes, size_t &position,
+					   double &value) {
+	uint64_t bits = 0;
+	if (position > bytes.size() || bytes.size() - position < sizeof(bits)) {
+		return false;
+	}
+	for (size_t i = 0; i < sizeof(bits); ++i) {
+		bits |= static_cast<uint64_t>(
+			static_cast<uint8_t>(bytes[position++])) << (8 * i);
+	}
+	std::memcpy(&value, &bits, sizeof(value));
+	return true;
+}
+/** Append a node with operator `op` and `child_count` children. */
+inline void AppendEncodedNode(std::string &bytes, OpType op,
+							  size_t child_count) {
+	size_t count = (child_count < kNodeChildEscape) ? child_count
+													: kNodeChildEscape;
+	bytes.push_back(static_cast<char>(op | (count << kNodeOperatorBits)));
+	if (count == kNodeChildEscape) {
+		AppendVarint(bytes, child_count - kNodeChildEscape);
+	}
+}
+/**
+ * Read a node written by `AppendEncodedNode()` from `bytes` at
+ * `position`, moving `position` past it.
+ *
+ * @return	False if `bytes` ends first or the operator isn't valid.
+ */
+inline bool ReadEncodedNode(const std::string &bytes, size_t &position,
+							OpType &op, size_t &child_count) {
+	if (position >= bytes.size()) {
+		return false;
+	}
+	uint8_t byte = static_cast<uint8_t>(bytes[position++]);
+	uint8_t code = byte & ((1u << kNodeOperatorBits) - 1);
+	if (code > OpType::kTurnRight) {
+		return false;
+	}
+	op = static_cast<OpType>(code);
+	child_count = byte >> kNodeOperatorBits;
+	if (child_count == kNodeChildEscape) {
+		uint64_t extra;
+		if (!ReadVarint(bytes, position, extra)) {
+			return false;
+		}
+		child_count += extra;
+	}
+	return true;
+}
@@ -0,0 +1,244 @@
+/*
+ * evaluation_context.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evaluation_context.h"
+#include <iostream> /* Logging/error reporting only */
+/* Ant struct */
+/**
+ * @todo	Allow for Ant placement to be defined in map file.
+ */
+Ant::Ant() : x(0), y(0), direction(Direction::kEast) {}
+void Ant::Reset() {
+	x = 0;
+	y = 0;
+	direction = Direction::kEast;
+}
+
+template <typename Geometry>
+BasicEvaluationContext<Geometry>::BasicEvaluationContext(
+	const MapDefinition *map) :
+	map_(map), geometry_(map), current_action_count_(0),
+	record_path_(false), pass_eaten_count_(0) {
+	size_t cell_count = map_->GetRowCount() * map_->GetColumnCount();
+	eaten_cells_.assign((cell_count + 63) / 64, 0);
+	pass_states_.assign((cell_count * 4 + 63) / 64, 0);
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::Reset() {
+	ant_.Reset();
+	for (uint32_t index : eaten_) {
+		eaten_cells_[index / 64] = 0;
+	}
+	eaten_.clear();
+	path_.clear();
+	current_action_count_ = 0;
+	ClearPassStates();
+	pass_eaten_count_ = 0;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::SetMap(const MapDefinition *map) {
+	map_ = map;
+	geometry_ = Geometry(map);
+	size_t cell_count = map_->GetRowCount() * map_->GetColumnCount();
+	eaten_cells_.assign((cell_count + 63) / 64, 0);
+	eaten_.clear();
+	pass_states_.assign((cell_count * 4 + 63) / 64, 0);
+	pass_state_list_.clear();
+	Reset();
+}
+template <typename Geometry>
+const MapDefinition* BasicEvaluationContext<Geometry>::GetMap() {
+	return map_;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::SetPathRecording(bool record_path) {
+	record_path_ = record_path;
+}
+template <typename Geometry>
+size_t BasicEvaluationContext<Geometry>::GetTotalFoodCount() {
+	return map_->GetTotalFoodCount();
+}
+template <typename Geometry>
+size_t BasicEvaluationContext<Geometry>::GetConsumedFoodCount() {
+	return map_->GetInitialConsumedFoodCount() + eaten_.size();
+}
+template <typename Geometry>
+std::string BasicEvaluationContext<Geometry>::ToString(bool latex) {
+	std::vector<bool> visited(map_->GetRowCount() * map_->GetColumnCount());
+	for (uint32_t index : eaten_) {
+		visited[index] = true;
+	}
+	for (uint32_t index : path_) {
+		visited[index] = true;
+	}
+
+	std::string printed_map;
+	for (size_t i = 0; i < map_->GetRowCount(); ++i) {
+		for (size_t j = 0; j < map_->GetColumnCount(); ++j) {
+			size_t index = map_->GetCellIndex(i, j);
+			TrailData d = map_->GetCell(i, j);
+			if (visited[index]) {
+				d = map_->HasFood(index) ? TrailData::kVisitedFood :
+										   TrailData::kVisitedEmpty;
+			}
+			printed_map += MapDefinition::ConvertTrailDataToChar(d);
+		}
+		printed_map += '\n';
+	}
+	printed_map.pop_back();
+	return printed_map;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::MoveForward() {
+	/* Short-circuit execution if the ant is over the action limit. */
+	if (!HasActionsRemaining()) {
+		return;
+	}
+	GetCellAhead(ant_.y, ant_.x);
+	++current_action_count_;
+
+	size_t index = geometry_.GetCellIndex(ant_.y, ant_.x);
+	if (map_->HasUneatenFood(index) && !IsEaten(index)) {
+		eaten_cells_[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+		eaten_.push_back(static_cast<uint32_t>(index));
+	}
+	if (record_path_) {
+		path_.push_back(static_cast<uint32_t>(index));
+	}
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::TurnLeft() {
+	/* Short-circuit execution if the ant is over the action limit. */
+	if (!HasActionsRemaining()) {
+		return;
+	}
+	switch (ant_.direction) {
+	case Direction::kNorth:
+		ant_.direction = Direction::kWest;
+		break;
+	case Direction::kEast:
+		ant_.direction = Direction::kNorth;
+		break;
+	case Direction::kSouth:
+		ant_.direction = Direction::kEast;
+		break;
+	case Direction::kWest:
+		ant_.direction = Direction::kSouth;
+		break;
+	}
+	++current_action_count_;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::TurnRight() {
+	/* Short-circuit execution if the ant is over the action limit. */
+	if (!HasActionsRemaining()) {
+		return;
+	}
+	switch (ant_.direction) {
+	case Direction::kNorth:
+		ant_.direction = Direction::kEast;
+		break;
+	case Direction::kEast:
+		ant_.direction = Direction::kSouth;
+		break;
+	case Direction::kSouth:
+		ant_.direction = Direction::kWest;
+		break;
+	case Direction::kWest:
+		ant_.direction = Direction::kNorth;
+		break;
+	}
+	++current_action_count_;
+}
+template <typename Geometry>
+bool BasicEvaluationContext<Geometry>::IsFoodAhead() {
+	size_t row;
+	size_t column;
+	GetCellAhead(row, column);
+	size_t index = geometry_.GetCellIndex(row, column);
+	return map_->HasUneatenFood(index) && !IsEaten(index);
+}
+template <typename Geometry>
+bool BasicEvaluationContext<Geometry>::HasActionsRemaining() {
+	return current_action_count_ < map_->GetActionLimit();
+}
+template <typename Geometry>
+size_t BasicEvaluationContext<Geometry>::GetRemainingActionCount() {
+	return map_->GetActionLimit() - current_action_count_;
+}
+template <typename Geometry>
+bool BasicEvaluationContext<Geometry>::IsTrailCleared() {
+	return GetConsumedFoodCount() >= map_->GetTotalFoodCount();
+}
+template <typename Geometry>
+bool BasicEvaluationContext<Geometry>::IsRepeatingPass() {
+	/* Eating changes the map, so older states no longer predict anything. */
+	if (eaten_.size() != pass_eaten_count_) {
+		ClearPassStates();
+		pass_eaten_count_ = eaten_.size();
+	}
+	size_t cell = geometry_.GetCellIndex(ant_.y, ant_.x);
+	uint32_t state = static_cast<uint32_t>(
+		cell * 4 + static_cast<size_t>(ant_.direction));
+	uint64_t bit = static_cast<uint64_t>(1) << (state % 64);
+	if (pass_states_[state / 64] & bit) {
+		return true;
+	}
+	pass_states_[state / 64] |= bit;
+	pass_state_list_.push_back(state);
+	return false;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::GetCellAhead(size_t &row, size_t &column) {
+	row = ant_.y;
+	column = ant_.x;
+	/* The geometry handles wrapping around the edges of the map. */
+	switch (ant_.direction) {
+	case Direction::kNorth:
+		row = geometry_.North(row);
+		break;
+	case Direction::kEast:
+		column = geometry_.East(column);
+		break;
+	case Direction::kSouth:
+		row = geometry_.South(row);
+		break;
+	case Direction::kWest:
+		column = geometry_.West(column);
+		break;
+	default:
+		std::cerr << "Ant cannot move in third dimension!" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+}
+template <typename Geometry>
+bool BasicEvaluationContext<Geometry>::IsEaten(size_t index) {
+	return (eaten_cells_[index / 64] >> (index % 64)) & 1;
+}
+template <typename Geometry>
+void BasicEvaluationContext<Geometry>::ClearPassStates() {
+	for (uint32_t state : pass_state_list_) {
+		pass_states_[state / 64] = 0;
+	}
+	pass_state_list_.clear();
+}
+
+template class BasicEvaluationContext<RuntimeGeometry>;
+template class BasicEvaluationContext<FixedGeometry<32, 32>>;
@@ -0,0 +1,164 @@
+/*
+ * evaluation_context.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * The mutable state of a single Ant traversing a `MapDefinition`.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "map_definition.h"
+#include "map_geometry.h"
+/**
+ * @enum	Direction
+ * Represents the cardinal directions that the ant can be facing.
+ */
+enum class Direction {
+	kNorth,
+	kEast,
+	kSouth,
+	kWest
+};
+ /**
+ * @struct	Ant
+ * Simple structure to represent location of the Ant at a given time.
+ */
+struct Ant {
+	Ant();	/**< Constructor sets ant's start position and direction. */
+	void Reset(); /**< Reset does the same thing as the constructor */
+	size_t x;	/**< The column number the ant is on. */
+	size_t y;	/**< The row number the ant is on. */
+	Direction direction; /**< The direction the ant is facing. */
+};
+/**
+ * @class	BasicEvaluationContext
+ * Lightweight overlay on top of a shared `MapDefinition` holding everything
+ * that changes while an ant runs: the ant itself, the number of actions it
+ * has taken and the food it has eaten.  The eaten food is kept as one bit
+ * per cell, for constant-time lookups, along with a list of the cells set,
+ * so a reset only clears the bits of the food that was eaten and the grid
+ * itself is never copied.
+ * Each thread evaluating individuals needs its own context, but they can
+ * all point at the same definition.
+ *
+ * The `Geometry` parameter supplies the wraparound arithmetic, either
+ * `RuntimeGeometry` for maps of any size or a `FixedGeometry` for a size
+ * known at compile time.  Use the `EvaluationContext` and
+ * `EvaluationContext32x32` names rather than the template directly.
+ */
+template <typename Geometry>
+class BasicEvaluationContext {
+public:
+	/**
+	 * Create a context for the given map.  The context starts out reset.
+	 *
+	 * @param[in]	*map	The map definition to traverse.  It must have the
+	 *						size `Geometry` expects.
+	 */
+	BasicEvaluationContext(const MapDefinition *map);
+	/** Reset the state of the Ant and eaten food back to a fresh state */
+	void Reset();
+	/** Point the context at a different map and reset it. */
+	void SetMap(const MapDefinition *map);
+	/** Return the map definition being traversed. */
+	const MapDefinition* GetMap();
+	/**
+	 * Record every cell the ant moves on so the route can be drawn by
+	 * `ToString()`.  Recording is off by default because evaluation only
+	 * needs the eaten food.
+	 */
+	void SetPathRecording(bool record_path);
+	/** Return the total number of food on the map. */
+	size_t GetTotalFoodCount();
+	/** Return the number of consumed food on the map. */
+	size_t GetConsumedFoodCount();
+	/** Return the map as a string.
+	 *
+	 * @param[in]	latex	Add formatting for placing in a LaTeX file.
+	 *
+	 * @return	`std::string` with one row per line representing the map
+	 *			with the eaten food, and the route if it was recorded.
+	 *
+	 * @todo	Add LaTeX wrappings.
+	 */
+	std::string ToString(bool latex);
+	/** Moves the ant forward on the map */
+	void MoveForward();
+	/** Turns the ant left (anticlockwise) */
+	void TurnLeft();
+	/** Turns the ant right (clockwise) */
+	void TurnRight();
+	/** Returns the status of uneaten food being ahead of the ant */
+	bool IsFoodAhead();
+	/** Returns whether the ant has any actions left to take */
+	bool HasActionsRemaining();
+	/** Returns the number of actions the ant has left to take. */
+	size_t GetRemainingActionCount();
+	/** Returns whether every piece of food on the map has been eaten. */
+	bool IsTrailCleared();
+	/**
+	 * Record the state of the ant at the start of a pass through the
+	 * program.  The ant's position and direction together with the food
+	 * left on the map determine everything a pass does, so an ant that
+	 * starts a pass in the same state as an earlier pass, without having
+	 * eaten in between, is stuck in a loop and will never eat again.
+	 *
+	 * @return	True if the state repeated and the run can stop early.
+	 */
+	bool IsRepeatingPass();
+
+private:
+	/**
+	 * Determine the coordinates of the cell directly in front of the ant.
+	 *
+	 * @param[out]	row		The row of the cell ahead.
+	 * @param[out]	column	The column of the cell ahead.
+	 */
+	void GetCellAhead(size_t &row, size_t &column);
+	/** Returns whether the food in a cell has been eaten during this run. */
+	bool IsEaten(size_t index);
+	/** Forget the pass states recorded by `IsRepeatingPass()`. */
+	void ClearPassStates();
+
+	const MapDefinition *map_;
+	Geometry geometry_;
+	Ant ant_;
+	size_t current_action_count_;
+	std::vector<uint64_t> eaten_cells_; /**< One bit per cell, if eaten. */
+	std::vector<uint32_t> eaten_; /**< Cells whose food has been eaten. */
+	std::vector<uint32_t> path_; /**< Cells moved on, if recording. */
+	bool record_path_;
+	/** One bit per (cell, direction) a pass started in since food was eaten. */
+	std::vector<uint64_t> pass_states_;
+	std::vector<uint32_t> pass_state_list_; /**< Set bits, for clearing. */
+	size_t pass_eaten_count_; /**< Size of `eaten_` at the last pass. */
+};
+/** Context for maps of any size. */
+typedef BasicEvaluationContext<RuntimeGeometry> EvaluationContext;
+/** Context specialized for the 32x32 maps most runs use. */
+typedef BasicEvaluationContext<FixedGeometry<32, 32>> EvaluationContext32x32;
+
+/* Both contexts are instantiated once in evaluation_context.cpp. */
+extern template class BasicEvaluationContext<RuntimeGeometry>;
+extern template class BasicEvaluationContext<FixedGeometry<32, 32>>;
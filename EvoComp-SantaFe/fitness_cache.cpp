@@ -0,0 +1,129 @@
+/*
+ * fitness_cache.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fitness_cache.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream> /* Logging/error reporting only */
+#include <sstream>
+#include "hash.h"
+
+uint64_t FitnessCache::HashMapSet(
+	const std::vector<const MapDefinition*> &maps) {
+	uint64_t hash = HashCombine(0, maps.size());
+	for (const MapDefinition *map : maps) {
+		hash = HashCombine(hash, map->GetHash());
+	}
+	return hash;
+}
+bool FitnessCache::Find(uint64_t tree_hash, uint64_t map_set_hash,
+						size_t tree_size, Scores &scores) {
+	Key key = { tree_hash, map_set_hash };
+	Shard &shard = GetShard(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto it = shard.entries.find(key);
+	if (it == shard.entries.end() || it->second.tree_size != tree_size) {
+		return false;
+	}
+	scores = it->second.scores;
+	return true;
+}
+void FitnessCache::Insert(uint64_t tree_hash, uint64_t map_set_hash,
+						  size_t tree_size, const Scores &scores) {
+	Key key = { tree_hash, map_set_hash };
+	Shard &shard = GetShard(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	if (shard.entries.size() >= kMaxShardSize) {
+		shard.entries.clear();
+	}
+	Entry &entry = shard.entries[key];
+	entry.tree_size = tree_size;
+	entry.scores = scores;
+}
+size_t FitnessCache::GetSize() {
+	size_t size = 0;
+	for (Shard &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		size += shard.entries.size();
+	}
+	return size;
+}
+void FitnessCache::Load(std::string filename) {
+	std::ifstream inf(filename);
+	std::string line;
+
+	if (!inf) {
+		return;
+	}
+	/*
+	 * Each line is:
+	 *	tree_hash map_set_hash tree_size map_count (consumed total)...
+	 */
+	while (std::getline(inf, line)) {
+		std::istringstream ss(line);
+		uint64_t tree_hash;
+		uint64_t map_set_hash;
+		size_t tree_size;
+		size_t map_count;
+		Scores scores;
+
+		bool valid = static_cast<bool>(ss >> std::hex >> tree_hash >>
+									   map_set_hash >> std::dec >>
+									   tree_size >> map_count);
+		for (size_t i = 0; valid && i < map_count; ++i) {
+			std::pair<size_t, size_t> score;
+			valid = static_cast<bool>(ss >> score.first >> score.second);
+			scores.emplace_back(score);
+		}
+		/* Anything left over means the line is from some other format. */
+		if (!valid || !(ss >> std::ws).eof()) {
+			std::cerr << "Skipping malformed fitness cache entry in ";
+			std::cerr << filename << ": " << line << std::endl;
+			continue;
+		}
+		Insert(tree_hash, map_set_hash, tree_size, scores);
+	}
+}
+void FitnessCache::Save(std::string filename) {
+	std::ofstream outf(filename, std::ios::out | std::ios::trunc);
+
+	if (!outf.is_open()) {
+		std::cerr << "Could not open fitness cache file: ";
+		std::cerr << filename << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	for (Shard &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		for (auto &entry : shard.entries) {
+			outf << std::hex << entry.first.tree_hash << " ";
+			outf << entry.first.map_set_hash << std::dec << " ";
+			outf << entry.second.tree_size << " ";
+			outf << entry.second.scores.size();
+			for (auto &score : entry.second.scores) {
+				outf << " " << score.first << " " << score.second;
+			}
+			outf << "\n";
+		}
+	}
+}
+FitnessCache::Shard &FitnessCache::GetShard(const Key &key) {
+	/* The low bits pick the bucket within a shard, so use the high bits. */
+	return shards_[(key.tree_hash >> 58) % kShardCount];
+}
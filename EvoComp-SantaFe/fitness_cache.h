@@ -0,0 +1,118 @@
+/*
+ * fitness_cache.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "map_definition.h"
+
+/**
+ * @class	FitnessCache
+ * Remembers the scores of every tree that has been simulated, keyed by the
+ * structural hash of the tree and the hash of the set of maps it ran on.
+ * Structurally identical trees always eat the same food, so elites carried
+ * into the next generation and offspring identical to a parent don't need
+ * to be simulated again.  The size of the tree is stored with its scores
+ * and has to match as well, so two trees whose hashes collide only share
+ * scores if they also have the same number of nodes.
+ *
+ * The table is split into independently locked shards so that several
+ * threads can look up and insert scores at once.  A shard that grows past
+ * `kMaxShardSize` entries is emptied rather than growing without bound.
+ * The cache can be saved to and loaded from a text file, so runs over the
+ * same maps with the same action limit can share their results.  The cache
+ * only saves time, so entries of the file that can't be read are skipped
+ * with a warning rather than stopping the run.
+ */
+class FitnessCache {
+public:
+	/** Consumed and total food counts for each map, as `Individual` uses. */
+	typedef std::vector<std::pair<size_t, size_t>> Scores;
+	/**
+	 * Return the hash identifying a set of maps.  The order of the maps
+	 * matters, since scores are stored per map.
+	 */
+	static uint64_t HashMapSet(const std::vector<const MapDefinition*> &maps);
+	/**
+	 * Look up the scores of a tree.
+	 *
+	 * @param[in]	tree_hash		Structural hash of the tree.
+	 * @param[in]	map_set_hash	Hash from `HashMapSet()`.
+	 * @param[in]	tree_size		Number of nodes in the tree.
+	 * @param[out]	scores			The cached scores, if found.
+	 *
+	 * @return	True if the scores were found for a tree of the same size.
+	 */
+	bool Find(uint64_t tree_hash, uint64_t map_set_hash, size_t tree_size,
+			  Scores &scores);
+	/** Store the scores of a tree, replacing any already stored. */
+	void Insert(uint64_t tree_hash, uint64_t map_set_hash, size_t tree_size,
+				const Scores &scores);
+	/** Return the number of cached entries. */
+	size_t GetSize();
+	/**
+	 * Add the entries saved in a file to the cache.  A missing file is not
+	 * an error, since the first run of a sweep won't have one yet.
+	 *
+	 * @param[in]	filename	File written by `Save()`.
+	 */
+	void Load(std::string filename);
+	/** Write every cached entry to a file, replacing its contents. */
+	void Save(std::string filename);
+private:
+	static const size_t kShardCount = 64;
+	static const size_t kMaxShardSize = 16384;
+	/** Key of a cache entry. */
+	struct Key {
+		uint64_t tree_hash;
+		uint64_t map_set_hash;
+		bool operator==(const Key &other) const {
+			return tree_hash == other.tree_hash &&
+				   map_set_hash == other.map_set_hash;
+		}
+	};
+	/** Hash of a key.  Both halves are already well mixed hashes. */
+	struct KeyHasher {
+		size_t operator()(const Key &key) const {
+			return static_cast<size_t>(key.tree_hash ^ key.map_set_hash);
+		}
+	};
+	/** What is stored for a key. */
+	struct Entry {
+		size_t tree_size; /**< Checked on a hit, against hash collisions. */
+		Scores scores;
+	};
+	/** A part of the table with its own lock. */
+	struct Shard {
+		std::mutex mutex;
+		std::unordered_map<Key, Entry, KeyHasher> entries;
+	};
+	/** Return the shard a key belongs to. */
+	Shard &GetShard(const Key &key);
+	Shard shards_[kShardCount];
+};
@@ -0,0 +1,46 @@
+/*
+ * hash.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Hashing helpers shared by the structural tree hash and the map hash.  The
+ * hashes are written to fitness cache files, so they must not depend on the
+ * standard library implementation or change between runs.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Mix `value` into `seed` and return the combined hash.  Uses the
+ * SplitMix64 finalizer so that small differences, e.g. a single operator
+ * in a tree, spread over the whole 64 bits.
+ */
+inline uint64_t HashCombine(uint64_t seed, uint64_t value) {
+	uint64_t x = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) +
+						 (seed >> 2));
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
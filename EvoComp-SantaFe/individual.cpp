@@ -22,73 +22,240 @@
 #include <deque>
 #include <iostream> /* Logging/error reporting only */
 #include <string> /* std::to_string() if this is even necessary anymore */
+#include <utility> /* std::move, std::swap */
+#include "encoding.h"
 
 Individual::Individual() {
-	root_ = new Node;
+	root_ = nullptr;
+	linear_ = false;
+	shared_ = false;
 	original_max_depth_ = 0;
 	terminal_count_ = 0;
 	nonterminal_count_ = 0;
 	fitness_ = 0;
+	steps_saved_ = 0;
+	hash_ = 0;
+	hash_dirty_ = true;
 }
-Individual::Individual(size_t depth_max, bool full_tree) : Individual() {
+Individual::Individual(size_t depth_max, bool full_tree, Rng &rng,
+					   bool linear, bool shared) : Individual() {
+	linear_ = linear;
+	shared_ = shared;
 	original_max_depth_ = depth_max;
-	GenerateTree(depth_max, full_tree);
+	GenerateTree(depth_max, full_tree, rng);
 }
-Individual::Individual(const Individual &to_copy) {
-	root_ = new Node;
-	root_->Copy(to_copy.root_);
+Individual::Individual(const Individual &to_copy) : Individual() {
+	*this = to_copy;
+}
+Individual& Individual::operator=(const Individual &to_copy) {
+	if (this == &to_copy) {
+		return *this;
+	}
+	/* Any old tree is left to its arena; the genome's storage is reused. */
+	linear_ = to_copy.linear_;
+	shared_ = to_copy.shared_;
+	if (linear_) {
+		root_ = nullptr;
+		genome_ = to_copy.genome_;
+	} else if (shared_) {
+		root_ = nullptr;
+		shared_tree_ = to_copy.shared_tree_;
+	} else if (to_copy.root_) {
+		root_ = Node::Create();
+		root_->Copy(to_copy.root_);
+	} else {
+		root_ = nullptr;
+	}
 	original_max_depth_ = to_copy.original_max_depth_;
 	terminal_count_ = to_copy.terminal_count_;
 	nonterminal_count_ = to_copy.nonterminal_count_;
 	fitness_ = to_copy.fitness_;
+	steps_saved_ = to_copy.steps_saved_;
 	CorrectTree();
+	/* The copy has the same structure, so the hash is still good. */
+	hash_ = to_copy.hash_;
+	hash_dirty_ = to_copy.hash_dirty_;
+	return *this;
+}
+Individual::Individual(Individual &&to_move) noexcept :
+	root_(to_move.root_), genome_(std::move(to_move.genome_)),
+	linear_(to_move.linear_), shared_tree_(std::move(to_move.shared_tree_)),
+	shared_(to_move.shared_), program_(std::move(to_move.program_)),
+	scores_(std::move(to_move.scores_)), fitness_(to_move.fitness_),
+	steps_saved_(to_move.steps_saved_), hash_(to_move.hash_),
+	hash_dirty_(to_move.hash_dirty_),
+	original_max_depth_(to_move.original_max_depth_),
+	terminal_count_(to_move.terminal_count_),
+	nonterminal_count_(to_move.nonterminal_count_) {
+	to_move.root_ = nullptr;
+}
+Individual& Individual::operator=(Individual &&to_move) noexcept {
+	Swap(to_move);
+	return *this;
+}
+void Individual::Swap(Individual &other) noexcept {
+	std::swap(root_, other.root_);
+	genome_.Swap(other.genome_);
+	std::swap(linear_, other.linear_);
+	shared_tree_.Swap(other.shared_tree_);
+	std::swap(shared_, other.shared_);
+	program_.Swap(other.program_);
+	scores_.swap(other.scores_);
+	std::swap(fitness_, other.fitness_);
+	std::swap(steps_saved_, other.steps_saved_);
+	std::swap(hash_, other.hash_);
+	std::swap(hash_dirty_, other.hash_dirty_);
+	std::swap(original_max_depth_, other.original_max_depth_);
+	std::swap(terminal_count_, other.terminal_count_);
+	std::swap(nonterminal_count_, other.nonterminal_count_);
 }
 void Individual::Erase() {
-	root_->Erase();
+	if (root_) {
+		root_->Erase();
+		root_ = nullptr;
+	}
 }
 std::string Individual::ToString(bool latex) {
+	if (linear_) {
+		return genome_.ToString(latex);
+	}
+	if (shared_) {
+		Node *tree = shared_tree_.ToTree();
+		std::string text = tree->ToString(latex);
+		tree->Erase();
+		return text;
+	}
 	return root_->ToString(latex);
 }
-void Individual::GenerateTree(size_t depth_max, bool full_tree) {
-	root_->GenerateTree(0, depth_max, nullptr, full_tree);
+void Individual::GenerateTree(size_t depth_max, bool full_tree, Rng &rng) {
+	if (linear_) {
+		genome_.Generate(depth_max, full_tree, rng);
+	} else if (shared_) {
+		shared_tree_.Generate(depth_max, full_tree, rng);
+	} else {
+		if (!root_) {
+			root_ = Node::Create();
+		}
+		root_->GenerateTree(0, depth_max, full_tree, rng);
+	}
+	CalculateTreeSize();
+	hash_dirty_ = true;
+}
+void Individual::Mutate(double mutation_rate, Rng &rng) {
+	if (linear_) {
+		genome_.Mutate(mutation_rate, original_max_depth_, rng);
+		CalculateTreeSize();
+		hash_dirty_ = true;
+		return;
+	}
+	if (shared_) {
+		shared_tree_.Mutate(mutation_rate, original_max_depth_, rng);
+		CalculateTreeSize();
+		hash_dirty_ = true;
+		return;
+	}
+
+	/*
+	 * One trial per node; nodes regenerated by a mutation draw their own.
+	 * The buffer is kept between calls so mutating doesn't touch the heap.
+	 */
+	static thread_local std::vector<uint8_t> mutations;
+	mutations.resize(GetTreeSize());
+	rng.FillBernoulli(mutation_rate, mutations.size(), mutations.data());
+	size_t next_mutation = 0;
+	root_->Mutate(mutation_rate, mutations, next_mutation, 0,
+				  original_max_depth_, rng);
 	CalculateTreeSize();
+	hash_dirty_ = true;
 }
-void Individual::Mutate(double mutation_rate) {
-	root_->Mutate(mutation_rate, original_max_depth_);
+size_t Individual::Simplify() {
+	CalculateTreeSize();
+	size_t old_size = GetTreeSize();
+
+	if (linear_) {
+		Node *tree = genome_.ToTree();
+		Node *simplified = tree->Simplify(FoodSense::kUnknown);
+		genome_.FromTree(simplified);
+		tree->Erase();
+		simplified->Erase();
+	} else if (shared_) {
+		Node *tree = shared_tree_.ToTree();
+		Node *simplified = tree->Simplify(FoodSense::kUnknown);
+		shared_tree_.FromTree(simplified);
+		tree->Erase();
+		simplified->Erase();
+	} else {
+		Node *simplified = root_->Simplify(FoodSense::kUnknown);
+		root_->Erase();
+		root_ = simplified;
+	}
+	CorrectTree();
+	return old_size - GetTreeSize();
 }
-std::pair<Node*, size_t> Individual::GetRandomNode(bool nonterminal) {
-	size_t upper_bound;
+std::pair<Node*, size_t> Individual::GetRandomNode(
+	bool nonterminal, std::vector<Node*> *ancestors, Rng &rng) {
+	size_t node_count;
 	size_t countdown;
 
 	/* Even if nonterminal is true, return root node if it's the only node. */
 	if (nonterminal_count_ == 0) {
+		if (ancestors) {
+			ancestors->clear();
+		}
 		return std::pair<Node*, size_t>(root_, 0); /** @todo	-1 instead? */
 	}
 
 	if (nonterminal) {
-		upper_bound = nonterminal_count_ - 1;
+		node_count = nonterminal_count_;
 	} else {
-		upper_bound = terminal_count_ - 1;
+		node_count = terminal_count_;
 	}
-	std::uniform_int_distribution<size_t> d{ 0,upper_bound };
-	countdown = d(Individual::GetEngine());
+	countdown = rng.NextBounded(static_cast<uint32_t>(node_count));
 
-	return root_->SelectNode(countdown, nonterminal);
+	return root_->SelectNode(countdown, nonterminal, ancestors);
+}
+size_t Individual::GetRandomPosition(bool nonterminal, Rng &rng) {
+	/* Even if nonterminal is true, return the root if it's the only node. */
+	if (nonterminal_count_ == 0) {
+		return 0;
+	}
+	size_t node_count = nonterminal ? nonterminal_count_ : terminal_count_;
+	size_t countdown = rng.NextBounded(static_cast<uint32_t>(node_count));
+	if (shared_) {
+		return shared_tree_.SelectPosition(countdown, nonterminal);
+	}
+	return genome_.SelectPosition(countdown, nonterminal);
 }
 void Individual::CalculateTreeSize() {
 	terminal_count_ = 0;
 	nonterminal_count_ = 0;
-	root_->CountNodes(terminal_count_, nonterminal_count_);
+	if (linear_) {
+		genome_.CountNodes(terminal_count_, nonterminal_count_);
+	} else if (shared_) {
+		shared_tree_.CountNodes(terminal_count_, nonterminal_count_);
+	} else if (root_) {
+		root_->CountNodes(terminal_count_, nonterminal_count_);
+	}
 }
-void Individual::CalculateScores(std::vector<TrailMap*> maps) {
-	RunSimulation(maps);
+void Individual::CalculateScores(
+	const std::vector<const MapDefinition*> &maps) {
+	CompileProgram();
 
 	scores_.clear();
-	for (TrailMap *map : maps) {
-		scores_.emplace_back(std::make_pair(map->GetConsumedFoodCount(),
+	steps_saved_ = 0;
+	for (const MapDefinition *map : maps) {
+		scores_.emplace_back(std::make_pair(RunSimulation(map),
 											map->GetTotalFoodCount()));
 	}
 }
+void Individual::SetScores(
+	const std::vector<std::pair<size_t, size_t>> &scores) {
+	scores_ = scores;
+}
+Program* Individual::GetProgram() {
+	CompileProgram();
+	return &program_;
+}
 void Individual::CalculateFitness() {
 	fitness_ = 0;
 	size_t total_count = 0;
@@ -100,12 +267,31 @@ void Individual::CalculateFitness() {
 	fitness_ = fitness_ / total_count; /* Divide by zero is okay here. */
 }
 void Individual::CorrectTree() {
-	root_->CorrectNodes(nullptr, 0);
 	CalculateTreeSize();
+	hash_dirty_ = true;
 }
 double Individual::GetFitness() {
 	return fitness_;
 }
+const std::vector<std::pair<size_t, size_t>>& Individual::GetScores() {
+	return scores_;
+}
+uint64_t Individual::GetHash() {
+	if (hash_dirty_) {
+		if (linear_) {
+			hash_ = genome_.Hash();
+		} else if (shared_) {
+			hash_ = shared_tree_.Hash();
+		} else {
+			hash_ = root_->Hash();
+		}
+		hash_dirty_ = false;
+	}
+	return hash_;
+}
+size_t Individual::GetStepsSaved() {
+	return steps_saved_;
+}
 size_t Individual::GetTreeSize() {
 	return GetTerminalCount() + GetNonterminalCount();
 }
@@ -115,37 +301,146 @@ size_t Individual::GetTerminalCount() {
 size_t Individual::GetNonterminalCount() {
 	return nonterminal_count_;
 }
+size_t Individual::GetGenomeBytes() {
+	return genome_.GetReservedBytes();
+}
+size_t Individual::GetScoreBytes() {
+	return scores_.capacity() * sizeof(scores_[0]);
+}
+size_t Individual::GetProgramBytes() {
+	return program_.GetReservedBytes();
+}
+bool Individual::IsLinear() {
+	return linear_;
+}
+LinearGenome* Individual::GetGenome() {
+	return &genome_;
+}
+bool Individual::IsShared() {
+	return shared_;
+}
+SharedTree* Individual::GetSharedTree() {
+	return &shared_tree_;
+}
+void Individual::SetShared(bool shared) {
+	if (linear_ || shared == shared_) {
+		return;
+	}
+	if (shared) {
+		shared_tree_.FromTree(root_);
+		Erase();
+	} else {
+		root_ = shared_tree_.ToTree();
+		shared_tree_ = SharedTree();
+	}
+	shared_ = shared;
+}
+void Individual::Encode(std::string &bytes) {
+	AppendVarint(bytes, original_max_depth_);
+	if (linear_) {
+		genome_.Encode(bytes);
+	} else if (shared_) {
+		shared_tree_.Encode(bytes);
+	} else {
+		/* Interning only reads the nodes, so no arena is needed. */
+		SharedTree tree;
+		tree.FromTree(root_);
+		tree.Encode(bytes);
+	}
+	AppendVarint(bytes, scores_.size());
+	for (auto score : scores_) {
+		AppendVarint(bytes, score.first);
+		AppendVarint(bytes, score.second);
+	}
+}
+bool Individual::Decode(const std::string &bytes, size_t &position,
+						bool linear) {
+	uint64_t max_depth, score_count;
+	if (!ReadVarint(bytes, position, max_depth)) {
+		return false;
+	}
+	if (linear) {
+		if (!genome_.Decode(bytes, position)) {
+			return false;
+		}
+		shared_tree_ = SharedTree();
+	} else if (!shared_tree_.Decode(bytes, position)) {
+		return false;
+	}
+	/* Each score takes at least two bytes, which bounds a corrupt count. */
+	if (!ReadVarint(bytes, position, score_count) ||
+		score_count > bytes.size() - position) {
+		return false;
+	}
+	scores_.resize(score_count);
+	for (auto &score : scores_) {
+		uint64_t food, total;
+		if (!ReadVarint(bytes, position, food) ||
+			!ReadVarint(bytes, position, total)) {
+			return false;
+		}
+		score = std::make_pair(food, total);
+	}
+	root_ = nullptr;
+	linear_ = linear;
+	shared_ = !linear;
+	original_max_depth_ = max_depth;
+	steps_saved_ = 0;
+	CorrectTree();
+	CalculateFitness();
+	return true;
+}
 Node* Individual::GetRootNode() {
 	return root_;
 }
 void Individual::SetRootNode(Node *root) {
 	root_ = root;
+	hash_dirty_ = true;
 }
 std::vector<std::string> Individual::PrintSolvedMap(
-	std::vector<TrailMap*> maps, bool latex) {
+	std::vector<const MapDefinition*> maps, bool latex) {
 	std::vector<std::string> printed_maps;
-	for (TrailMap *map : maps) {
-		RunSimulation(map);
-		printed_maps.emplace_back(map->ToString(latex));
+	CompileProgram();
+	for (const MapDefinition *map : maps) {
+		EvaluationContext context(map);
+		context.SetPathRecording(true);
+		RunSimulation(&context);
+		printed_maps.emplace_back(context.ToString(latex));
 	}
 	return printed_maps;
 }
 std::string Individual::CallGraphViz(std::string graph_name) {
+	if (linear_ || shared_) {
+		Node *tree = linear_ ? genome_.ToTree() : shared_tree_.ToTree();
+		std::string graph = tree->CallGraphViz(graph_name);
+		tree->Erase();
+		return graph;
+	}
 	return root_->CallGraphViz(graph_name);
 }
-std::mt19937 &Individual::GetEngine() {
-	static std::random_device rd;
-	static std::mt19937 mt(rd());
-	return mt;
-}
-void Individual::RunSimulation(std::vector<TrailMap*> maps) {
-	for (TrailMap *map : maps) {
-		RunSimulation(map);
+void Individual::CompileProgram() {
+	if (linear_) {
+		program_.Compile(genome_);
+	} else if (shared_) {
+		program_.Compile(shared_tree_);
+	} else {
+		program_.Compile(root_);
 	}
 }
-void Individual::RunSimulation(TrailMap *map) {
-	map->Reset();
-	while (map->HasActionsRemaining()) {
-		root_->Evaluate(map);
+size_t Individual::RunSimulation(const MapDefinition *map) {
+	if (FixedGeometry<32, 32>::Matches(map)) {
+		EvaluationContext32x32 context(map);
+		RunSimulation(&context);
+		steps_saved_ += context.GetRemainingActionCount();
+		return context.GetConsumedFoodCount();
 	}
+	EvaluationContext context(map);
+	RunSimulation(&context);
+	steps_saved_ += context.GetRemainingActionCount();
+	return context.GetConsumedFoodCount();
+}
+template <typename Context>
+void Individual::RunSimulation(Context *context) {
+	context->Reset();
+	program_.Run(context);
 }
\ No newline at end of file
@@ -23,33 +23,72 @@
  */
 #pragma once
 
-#include <random>
 #include <utility>
 #include <vector>
+#include "evaluation_context.h"
+#include "linear_genome.h"
+#include "map_definition.h"
 #include "node.h"
-#include "trail_map.h"
+#include "program.h"
+#include "rng.h"
+#include "shared_tree.h"
 
 /**
  * @class	Individual
  * Contains a single tree that represents the set of instructions that the
- * ant will follow.
+ * ant will follow.  The tree is either a tree of `Node` objects, a
+ * `LinearGenome` for a linear individual, or a `SharedTree` for a shared
+ * one.  Everything but the node-level accessors (`GetRootNode()`,
+ * `GetRandomNode()` and friends for trees, `GetGenome()`,
+ * `GetSharedTree()` and `GetRandomPosition()` for the others) works on all
+ * three.
+ *
+ * An individual owns its tree: copying one copies the tree, and moving one
+ * hands the tree over.  The nodes themselves belong to the `NodeArena`
+ * they were made in, which frees them along with the rest of their
+ * generation, so destroying an individual doesn't walk its tree.
  */
 class Individual {
 public:
 	/**
-	 * `Individual` class empty constructor.  Used only to create an empty
-	 * root node of the tree.
+	 * `Individual` class empty constructor.  Creates an individual without
+	 * a tree, only to be assigned over or given a tree by `GenerateTree()`.
 	 */
 	Individual();
-	/** `Individual` class constructor that also generates the tree. */
-	Individual(size_t depth_max, bool full_tree);
+	/**
+	 * `Individual` class constructor that also generates the tree.
+	 *
+	 * @param[in]	linear	Store the tree as a `LinearGenome` instead of
+	 *						`Node` objects.
+	 * @param[in]	shared	Store the tree as a `SharedTree` instead of
+	 *						`Node` objects.
+	 */
+	Individual(size_t depth_max, bool full_tree, Rng &rng,
+			   bool linear = false, bool shared = false);
 	/** 
 	 * `Individual` class copy constructor.  This copy constructor creates a 
-	 * new root node, copies the tree from the source tree and then corrects
-	 * the pointers to all the `parent_` variables afterwards.
+	 * new root node and copies the tree from the source tree.  A genome is
+	 * simply copied, and a shared tree is shared.
 	 */
 	Individual(const Individual &to_copy);
-	/** Call `root_->Erase()` to delete the entire solution tree. */
+	/** Take over the tree of `to_move`, leaving it without one. */
+	Individual(Individual &&to_move) noexcept;
+	/**
+	 * Replace the tree with a copy of the tree of `to_copy`, the same way
+	 * as the copy constructor.  The old tree is left to its arena rather
+	 * than erased, since it may belong to a generation that has already
+	 * been released, and the storage of the genome is reused.  The scores
+	 * aren't copied.
+	 */
+	Individual& operator=(const Individual &to_copy);
+	/** Exchange everything with `to_move`. */
+	Individual& operator=(Individual &&to_move) noexcept;
+	/** Exchange everything, trees included, with another individual. */
+	void Swap(Individual &other) noexcept;
+	/**
+	 * Call `root_->Erase()` to return the entire solution tree to the
+	 * current `NodeArena` for reuse.  The individual is left without a tree.
+	 */
 	void Erase();
 	/** 
 	 * Create a `std::string` of the tree.  Optionally LaTeX functions can be
@@ -62,17 +101,36 @@ public:
 	 * maximum depth specified or a sparse tree of any size up to the maximum
 	 * depth.
 	 */
-	void GenerateTree(size_t depth_max, bool full_tree);
+	void GenerateTree(size_t depth_max, bool full_tree, Rng &rng);
 	/** 
 	 * Mutate the solution.  The probability of an individual node is passed
-	 * to the tree.
+	 * to the tree, along with whether each node mutates, drawn for the whole
+	 * tree at once.
 	 */
-	void Mutate(double mutation_rate);
+	void Mutate(double mutation_rate, Rng &rng);
+	/**
+	 * Replace the solution tree with a simplified version of itself.  See
+	 * `Node::Simplify()` for the rewrites that are applied.
+	 *
+	 * @return	The number of nodes removed from the tree.
+	 */
+	size_t Simplify();
 	/** 
 	 * Select a random terminal or nonterminal node and return the node and
 	 * its index according to its parent node.
+	 *
+	 * @param[out]	ancestors	If not null, set to the ancestors of the node
+	 *							from the root down to its parent, or left
+	 *							empty if the root was selected.
+	 */
+	std::pair<Node*, size_t> GetRandomNode(bool nonterminal,
+										   std::vector<Node*> *ancestors,
+										   Rng &rng);
+	/**
+	 * Select a random terminal or nonterminal node of a linear or shared
+	 * individual and return its prefix-order position in the tree.
 	 */
-	std::pair<Node*, size_t> GetRandomNode(bool nonterminal);
+	size_t GetRandomPosition(bool nonterminal, Rng &rng);
 	/**
 	 * Calculate the number of terminal and nonterminal nodes and store them
 	 * for later retrieval.
@@ -81,25 +139,95 @@ public:
 	/**
 	 * Calculate the scores of the individual based on the maps given.
 	 */
-	void CalculateScores(std::vector<TrailMap*> maps);
+	void CalculateScores(const std::vector<const MapDefinition*> &maps);
+	/**
+	 * Set the scores of the individual directly.  Used when the scores were
+	 * calculated outside of the individual, such as by a `BatchEvaluator`.
+	 *
+	 * @param[in]	scores	Consumed and total food counts for each map.
+	 */
+	void SetScores(const std::vector<std::pair<size_t, size_t>> &scores);
+	/**
+	 * Compile the solution tree and return the compiled program.  The
+	 * program remains valid until the tree is next compiled.
+	 */
+	Program* GetProgram();
 	/**
 	 * Calculate the fitness of the individual based on the scores that were
 	 * set previously.
 	 */
 	void CalculateFitness();
 	/**
-	 * Correct the `parent_` variable pointers for the entire tree.  This is
-	 * necessary after copying the tree during the crossover operation.
+	 * Recount the nodes and mark the hash stale.  This is necessary after
+	 * the tree is changed in place, as by the crossover operation.
 	 */
 	void CorrectTree();
 	/** Return the fitness of the Individual */
 	double GetFitness();
+	/** Return the consumed and total food counts for each map. */
+	const std::vector<std::pair<size_t, size_t>>& GetScores();
+	/**
+	 * Return the structural hash of the solution tree.  A `Node` tree and a
+	 * `SharedTree` keep the hash of every subtree up to date as they
+	 * change, so their hash is read in constant time.  A `LinearGenome` is
+	 * hashed in one pass over its array, and only if it has changed since
+	 * the hash was last asked for.
+	 */
+	uint64_t GetHash();
+	/**
+	 * Return the number of actions the ant was allowed but didn't need
+	 * during the last `CalculateScores()`, because it cleared the trail or
+	 * got stuck in a loop.
+	 */
+	size_t GetStepsSaved();
 	/** Return the size of the tree of the Individual */
 	size_t GetTreeSize();
 	/** Return the number of terminal nodes in the tree. */
 	size_t GetTerminalCount();
 	/** Return the number of nonterminal nodes in the tree. */
 	size_t GetNonterminalCount();
+	/** Return the number of bytes held for the genome, if linear. */
+	size_t GetGenomeBytes();
+	/** Return the number of bytes held for the scores. */
+	size_t GetScoreBytes();
+	/** Return the number of bytes held for the compiled program. */
+	size_t GetProgramBytes();
+	/** Returns true if the tree is stored as a `LinearGenome`. */
+	bool IsLinear();
+	/** Return the genome of a linear individual. */
+	LinearGenome* GetGenome();
+	/** Returns true if the tree is stored as a `SharedTree`. */
+	bool IsShared();
+	/** Return the tree of a shared individual. */
+	SharedTree* GetSharedTree();
+	/**
+	 * Store the tree of an individual that isn't linear as a `SharedTree`
+	 * or as `Node` objects.  A shared individual doesn't refer to any
+	 * `NodeArena`, so it can be handed to another thread.  The nodes are
+	 * made in, or freed to, the current arena, so a `Node` tree has to
+	 * have been made there.
+	 */
+	void SetShared(bool shared);
+	/**
+	 * Append the individual to `bytes` in the compact encoding of
+	 * `encoding.h`: its maximum depth, its tree in prefix order and its
+	 * scores.  The encoding is the same whichever way the tree is stored.
+	 */
+	void Encode(std::string &bytes);
+	/**
+	 * Replace the individual with one written by `Encode()`, read from
+	 * `bytes` at `position`, and move `position` past it.  The fitness is
+	 * calculated from the scores read.
+	 *
+	 * @param[in]		bytes		The encoded individuals.
+	 * @param[in,out]	position	Where the individual starts.
+	 * @param[in]		linear		Store the tree as a `LinearGenome`
+	 *								rather than a `SharedTree`.
+	 *
+	 * @return	False if the encoding isn't valid, in which case the
+	 *			individual should only be assigned over or destroyed.
+	 */
+	bool Decode(const std::string &bytes, size_t &position, bool linear);
 	/** Return the pointer to the root node of the tree. */
 	Node* GetRootNode();
 	/** 
@@ -109,8 +237,8 @@ public:
 	 */
 	void SetRootNode(Node *root);
 	/**
-	 * Runs the `TrailMap::Ant` through each of the maps, leaving the map to
-	 * contain the path that was followed.
+	 * Runs the `Ant` through each of the maps, recording the path that was
+	 * followed.
 	 *
 	 * @param[in]	maps	A list of maps to traverse.
 	 * @param[in]	latex	Add any necessary wrappings for importing into
@@ -118,8 +246,8 @@ public:
 	 * @return	A `std::string` representation of a map with the route the ant
 	 * traversed shown.
 	 */
-	std::vector<std::string> PrintSolvedMap(std::vector<TrailMap*> maps,
-											bool latex);
+	std::vector<std::string> PrintSolvedMap(
+		std::vector<const MapDefinition*> maps, bool latex);
 	/** 
 	 * Wrapper to `Individual::root_::CallGraphViz()` and just sends the output
 	 * from that function back to the calling function.
@@ -132,26 +260,31 @@ public:
 	 */
 	std::string CallGraphViz(std::string graph_name);
 private:
+	/** 
+	 * Compile the solution tree into `program_`.  The tree is only compiled
+	 * once per simulation, no matter how many maps are being traversed.
+	 */
+	void CompileProgram();
 	/**
-	 * A static random engine that can be shared throughout the entire class.
-	 * Based on the idea found in:
-	 * http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3551.pdf
-	 * This class uses the well-defined STL Mersenne Twister engine, mt19937.
-	 * The first time this method is called, a std::mt19937 engine is
-	 * initialized and seeded by `std::random_device` and is returned.  All
-	 * subsequent calls return the originally created engine.
-	 *
-	 * @return	A Mersenne Twister Engine seeded by `std::random_device`.
+	 * Run the genetic program on a single map and return the amount of food
+	 * eaten.  32x32 maps are run with a context specialized for their size.
 	 */
-	std::mt19937 &GetEngine();
-	/** Run the genetic program on a list of maps */
-	void RunSimulation(std::vector<TrailMap*> maps);
-	/** Run the genetic program on a single map */
-	void RunSimulation(TrailMap *map);
+	size_t RunSimulation(const MapDefinition *map);
+	/** Run the genetic program using an already created context. */
+	template <typename Context>
+	void RunSimulation(Context *context);
 	
-	Node *root_; /**< Root node of the solution tree. */
+	Node *root_; /**< Root node of the solution tree, unless linear/shared. */
+	LinearGenome genome_; /**< The solution tree, if linear. */
+	bool linear_; /**< The tree is stored in `genome_`. */
+	SharedTree shared_tree_; /**< The solution tree, if shared. */
+	bool shared_; /**< The tree is stored in `shared_tree_`. */
+	Program program_; /**< Compiled form of the solution tree. */
 	std::vector<std::pair<size_t, size_t>> scores_; /**< Raw food counts. */
 	double fitness_; /**< Fitness score. */
+	size_t steps_saved_; /**< Actions skipped by the last evaluation. */
+	uint64_t hash_; /**< Structural hash of the tree, unless dirty. */
+	bool hash_dirty_; /**< The tree has changed since `hash_` was set. */
 	size_t original_max_depth_; /**< The original maximum depth of the tree. */
 	size_t terminal_count_;	/**< Number of terminal nodes in the tree. */
 	size_t nonterminal_count_; /**< Number of nonterminal nodes in the tree. */
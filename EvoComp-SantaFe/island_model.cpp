@@ -0,0 +1,145 @@
+/*
+ * island_model.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "island_model.h"
+#include <numeric> /* std::iota */
+#include <thread>
+#include <utility> /* std::swap */
+
+IslandModel::IslandModel(Options opts,
+						 std::vector<const MapDefinition*> maps,
+						 FitnessCache *fitness_cache) {
+	/* Room for more than one exchange, so a sender rarely has to wait. */
+	const size_t kQueueCapacity = 4;
+	opts_ = opts;
+	maps_ = maps;
+	fitness_cache_ = fitness_cache;
+	island_count_ = opts.island_count_;
+	migration_interval_ = opts.migration_interval_;
+	migration_size_ = opts.migration_size_;
+	random_topology_ = (opts.migration_topology_ == "random");
+	rng_ = Rng(opts.seed_ != 0 ? opts.seed_ : Rng::GetRandomSeed());
+	islands_.resize(island_count_);
+	for (size_t i = 0; i < island_count_ * island_count_; ++i) {
+		queues_.emplace_back(new SpscQueue<Migrants>(kQueueCapacity));
+	}
+}
+void IslandModel::Run(size_t generation_count, const Observer &observer) {
+	Exchange by_queue = [this](size_t island, size_t exchange,
+							   Migrants &migrants) {
+		ExchangeByQueue(island, exchange, migrants);
+	};
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < island_count_; ++i) {
+		threads.emplace_back(&IslandModel::RunIsland, this, i,
+							 generation_count, std::cref(observer),
+							 std::cref(by_queue));
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+}
+size_t IslandModel::GetIslandCount() {
+	return island_count_;
+}
+Population* IslandModel::GetIsland(size_t island) {
+	return islands_[island].get();
+}
+uint64_t IslandModel::GetSeed() {
+	return rng_.GetSeed();
+}
+void IslandModel::RunIsland(size_t island, size_t generation_count,
+							const Observer &observer,
+							const Exchange &exchange) {
+	Options opts = opts_;
+	opts.seed_ = rng_.Split(island).GetSeed();
+	islands_[island].reset(new Population(opts, maps_, fitness_cache_));
+	Population &population = *islands_[island];
+
+	Migrants migrants;
+	for (size_t generation = 1; generation <= generation_count;
+		 ++generation) {
+		population.Evolve();
+		Statistics statistics = {
+			population.GetBestFitness(), population.GetAverageFitness(),
+			population.GetBestTreeSize(), population.GetAverageTreeSize()
+		};
+		observer(island, statistics);
+
+		if (IsExchange(generation, generation_count)) {
+			population.Emigrate(migration_size_, migrants);
+			exchange(island, generation / migration_interval_, migrants);
+			population.Immigrate(migrants);
+		}
+	}
+}
+void IslandModel::ExchangeByQueue(size_t island, size_t exchange,
+								  Migrants &migrants) {
+	SpscQueue<Migrants> &outgoing =
+		GetQueue(island, GetDestination(island, exchange));
+	while (!outgoing.TryPush(migrants)) {
+		std::this_thread::yield();
+	}
+	SpscQueue<Migrants> &incoming =
+		GetQueue(GetSource(island, exchange), island);
+	while (!incoming.TryPop(migrants)) {
+		std::this_thread::yield();
+	}
+}
+bool IslandModel::IsExchange(size_t generation, size_t generation_count) {
+	/* Every island exchanges after the same generations. */
+	return migration_interval_ != 0 && island_count_ >= 2 &&
+		   generation % migration_interval_ == 0 &&
+		   generation != generation_count;
+}
+size_t IslandModel::GetDestination(size_t island, size_t exchange) {
+	if (!random_topology_) {
+		return (island + 1) % island_count_;
+	}
+	return GetPermutation(exchange)[island];
+}
+size_t IslandModel::GetSource(size_t island, size_t exchange) {
+	if (!random_topology_) {
+		return (island + island_count_ - 1) % island_count_;
+	}
+	std::vector<size_t> permutation = GetPermutation(exchange);
+	for (size_t source = 0; source < island_count_; ++source) {
+		if (permutation[source] == island) {
+			return source;
+		}
+	}
+	return island;
+}
+std::vector<size_t> IslandModel::GetPermutation(size_t exchange) {
+	/* Every island draws the same permutation from the run seed. */
+	Rng rng = rng_.Split(island_count_ + exchange);
+	std::vector<size_t> permutation(island_count_);
+	std::iota(permutation.begin(), permutation.end(), 0);
+	/* Sattolo's shuffle never leaves an island in place. */
+	for (size_t i = island_count_ - 1; i > 0; --i) {
+		size_t j = rng.NextBounded(static_cast<uint32_t>(i));
+		std::swap(permutation[i], permutation[j]);
+	}
+	return permutation;
+}
+SpscQueue<IslandModel::Migrants>& IslandModel::GetQueue(size_t from,
+														size_t to) {
+	return *queues_[from * island_count_ + to];
+}
@@ -0,0 +1,180 @@
+/*
+ * island_model.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "fitness_cache.h"
+#include "individual.h"
+#include "map_definition.h"
+#include "options.h"
+#include "population.h"
+#include "rng.h"
+#include "spsc_queue.h"
+
+/**
+ * @class	IslandModel
+ * Several populations, the islands, that evolve at the same time on a
+ * thread each and every few generations send copies of their best
+ * individuals to another island, where they replace the worst.  Each pair
+ * of islands has a `SpscQueue` in each direction, so no island ever takes
+ * a lock to migrate.
+ *
+ * On Linux the islands can also be separate processes, which a coordinator
+ * launches and talks to over a local socket.  Each worker process evolves
+ * one island, reports its statistics every generation, and sends its
+ * migrants to the coordinator, which passes them on in the encoding of
+ * `Individual::Encode()`.  A worker that fails can't corrupt the others,
+ * and the coordinator stops the run instead of waiting on it.
+ *
+ * The islands send to their neighbour in a ring, or to a random other
+ * island drawn anew for every exchange.  Either way, the island each one
+ * receives from only depends on the run seed, and an island waits for the
+ * migrants it is due, so a run with the same seed evolves the same
+ * individuals however the threads or processes are scheduled, and the
+ * same in both.
+ */
+class IslandModel {
+public:
+	/** What an island reports after each generation. */
+	struct Statistics {
+		double best_fitness;
+		double avg_fitness;
+		size_t best_size;
+		size_t avg_size;
+	};
+	/**
+	 * Called after each generation of an island, with the number of the
+	 * island and its statistics.
+	 */
+	typedef std::function<void(size_t island, const Statistics &statistics)>
+		Observer;
+
+	/**
+	 * Prepare the islands.  Each one is a `Population` made with `opts`
+	 * and a seed of its own, split from the run seed, and evolves on the
+	 * thread of its island alone.
+	 *
+	 * @param[in]	opts			Options of every island, including the
+	 *								number of islands and how they migrate.
+	 * @param[in]	maps			The maps all of the islands evolve on.
+	 * @param[in]	fitness_cache	Cache shared by all of the islands, or
+	 *								`nullptr`.  Not owned.
+	 */
+	IslandModel(Options opts, std::vector<const MapDefinition*> maps,
+				FitnessCache *fitness_cache = nullptr);
+	/**
+	 * Create the populations and evolve them for `generation_count`
+	 * generations, returning once every island is done.
+	 *
+	 * @param[in]	generation_count	Number of generations to evolve.
+	 * @param[in]	observer			Called by each island after each
+	 *									generation, on the island's thread.
+	 */
+	void Run(size_t generation_count, const Observer &observer);
+	/**
+	 * Launch a worker process for each island, which runs this program
+	 * with `arguments` and `--island-worker`, and pass the migrants and
+	 * statistics of the workers along until every island is done.  The
+	 * workers connect to a socket at the path of the options, or a
+	 * temporary one.  Stops the program if a worker fails.
+	 *
+	 * @param[in]	generation_count	Number of generations to evolve.
+	 * @param[in]	arguments			The command line of this program,
+	 *									which the workers are given.
+	 * @param[in]	observer			Called for each island after each
+	 *									generation.
+	 */
+	void RunProcesses(size_t generation_count,
+					  const std::vector<std::string> &arguments,
+					  const Observer &observer);
+	/**
+	 * Evolve one island in a worker process, talking to the coordinator
+	 * at the socket path of the options.  Stops the program if the
+	 * coordinator goes away.
+	 *
+	 * @param[in]	island				The number of the island.
+	 * @param[in]	generation_count	Number of generations to evolve.
+	 */
+	void RunWorker(size_t island, size_t generation_count);
+	/**
+	 * Returns true if `RunProcesses()` and `RunWorker()` work on this
+	 * platform.  They are defined in island_processes.cpp.
+	 */
+	static bool IsProcessSupported();
+	/** Return the number of islands. */
+	size_t GetIslandCount();
+	/**
+	 * Return the population of an island, once `Run()` has made it.  The
+	 * populations of worker processes aren't available.
+	 */
+	Population* GetIsland(size_t island);
+	/** Returns the seed the seeds of the islands are split from. */
+	uint64_t GetSeed();
+private:
+	/** The individuals one island sends another in one exchange. */
+	typedef std::vector<Individual> Migrants;
+	/**
+	 * Send an island's migrants for an exchange and replace them with the
+	 * ones it receives.
+	 */
+	typedef std::function<void(size_t island, size_t exchange,
+							   Migrants &migrants)> Exchange;
+
+	/** Make and evolve the population of one island. */
+	void RunIsland(size_t island, size_t generation_count,
+				   const Observer &observer, const Exchange &exchange);
+	/** Exchange migrants through the queues between the threads. */
+	void ExchangeByQueue(size_t island, size_t exchange, Migrants &migrants);
+	/** Return whether the islands exchange after `generation`. */
+	bool IsExchange(size_t generation, size_t generation_count);
+	/** Return the socket path of the run, or a temporary one. */
+	std::string GetSocketPath();
+	/** Return the island `island` sends its migrants to in an exchange. */
+	size_t GetDestination(size_t island, size_t exchange);
+	/** Return the island `island` receives its migrants from. */
+	size_t GetSource(size_t island, size_t exchange);
+	/**
+	 * Return the island each island sends to for an exchange, if random.
+	 * The islands form a single random cycle, so none sends to itself.
+	 */
+	std::vector<size_t> GetPermutation(size_t exchange);
+	/** Return the queue from island `from` to island `to`. */
+	SpscQueue<Migrants>& GetQueue(size_t from, size_t to);
+
+	Options opts_;
+	std::vector<const MapDefinition*> maps_;
+	FitnessCache *fitness_cache_;
+	size_t island_count_;
+	size_t migration_interval_; /**< Generations between exchanges. */
+	size_t migration_size_; /**< Individuals sent per exchange. */
+	bool random_topology_; /**< Send to random islands, not in a ring. */
+	Rng rng_; /**< Generator the islands' seeds are split from. */
+	std::vector<std::unique_ptr<Population>> islands_;
+	/** Queue from island `i` to island `j` at `i * island_count_ + j`. */
+	std::vector<std::unique_ptr<SpscQueue<Migrants>>> queues_;
+};
@@ -0,0 +1,271 @@
+/*
+ * island_processes.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * The parts of `IslandModel` that run the islands as worker processes.
+ * They need POSIX processes and sockets and find the program to run in
+ * `/proc`, so they are only built on Linux.  Elsewhere the functions are
+ * stubs, and `--island-processes` is rejected before any of them is
+ * called.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+
+#include "island_model.h"
+#include <cstdlib> /* exit, EXIT_FAILURE */
+#include <iostream> /* Logging/error reporting only */
+#if defined(__linux__)
+#include <climits> /* PATH_MAX */
+#include <csignal> /* kill, SIGTERM */
+#include <sys/wait.h>
+#include <unistd.h>
+#include "encoding.h"
+#include "migration_socket.h"
+
+bool IslandModel::IsProcessSupported() {
+	return true;
+}
+void IslandModel::RunProcesses(size_t generation_count,
+							   const std::vector<std::string> &arguments,
+							   const Observer &observer) {
+	/* How long to wait for a worker to connect before checking on them. */
+	const int kConnectPollMilliseconds = 100;
+	typedef MigrationSocket::MessageType MessageType;
+	std::string path = GetSocketPath();
+	MigrationSocket listener;
+	if (!listener.Listen(path)) {
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * The workers run the same executable under its own name, and the
+	 * argument lists are built before forking, which then only execs.
+	 */
+	char program[PATH_MAX];
+	ssize_t program_length = readlink("/proc/self/exe", program,
+									  sizeof(program) - 1);
+	if (program_length < 0) {
+		std::cerr << "Could not find the program to run the workers";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	program[program_length] = '\0';
+	std::vector<pid_t> workers;
+	for (size_t i = 0; i < island_count_; ++i) {
+		std::vector<std::string> worker_arguments = arguments;
+		worker_arguments.push_back("--island-worker");
+		worker_arguments.push_back(std::to_string(i));
+		if (opts_.island_socket_.empty()) {
+			worker_arguments.push_back("--island-socket");
+			worker_arguments.push_back(path);
+		}
+		std::vector<char*> argv;
+		for (std::string &argument : worker_arguments) {
+			argv.push_back(&argument[0]);
+		}
+		argv.push_back(nullptr);
+		pid_t pid = fork();
+		if (pid == 0) {
+			execv(program, argv.data());
+			_exit(EXIT_FAILURE);
+		}
+		if (pid < 0) {
+			std::cerr << "Could not start the worker of island " << i;
+			std::cerr << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		workers.push_back(pid);
+	}
+	/* Any failure stops every worker, so none is left waiting. */
+	auto fail = [&workers, &listener](std::string reason) {
+		std::cerr << reason << std::endl;
+		listener.Close();
+		for (pid_t pid : workers) {
+			kill(pid, SIGTERM);
+		}
+		for (pid_t pid : workers) {
+			waitpid(pid, nullptr, 0);
+		}
+		exit(EXIT_FAILURE);
+	};
+
+	/* Workers connect in any order and say which island they are. */
+	std::vector<std::unique_ptr<MigrationSocket>> sockets(island_count_);
+	std::string payload;
+	for (size_t connected = 0; connected < island_count_; ++connected) {
+		while (!listener.IsReady(kConnectPollMilliseconds)) {
+			for (pid_t pid : workers) {
+				if (waitpid(pid, nullptr, WNOHANG) == pid) {
+					fail("A worker stopped before connecting");
+				}
+			}
+		}
+		std::unique_ptr<MigrationSocket> socket(new MigrationSocket);
+		uint64_t island;
+		size_t position = 0;
+		if (!socket->Accept(listener) ||
+			!socket->Receive(MessageType::kHello, payload) ||
+			!ReadVarint(payload, position, island) ||
+			island >= island_count_ || sockets[island]) {
+			fail("A worker didn't introduce itself");
+		}
+		payload.clear();
+		AppendVarint(payload, rng_.GetSeed());
+		if (!socket->Send(MessageType::kHello, payload)) {
+			fail("Could not start island " + std::to_string(island));
+		}
+		sockets[island] = std::move(socket);
+	}
+	listener.Close();
+
+	/* Relay in the same order as the threads, so runs are the same. */
+	std::vector<std::string> outgoing(island_count_);
+	for (size_t generation = 1; generation <= generation_count;
+		 ++generation) {
+		for (size_t i = 0; i < island_count_; ++i) {
+			Statistics statistics;
+			uint64_t best_size, avg_size;
+			size_t position = 0;
+			if (!sockets[i]->Receive(MessageType::kStatistics, payload) ||
+				!ReadDouble(payload, position, statistics.best_fitness) ||
+				!ReadDouble(payload, position, statistics.avg_fitness) ||
+				!ReadVarint(payload, position, best_size) ||
+				!ReadVarint(payload, position, avg_size)) {
+				fail("Lost island " + std::to_string(i));
+			}
+			statistics.best_size = best_size;
+			statistics.avg_size = avg_size;
+			observer(i, statistics);
+		}
+		if (!IsExchange(generation, generation_count)) {
+			continue;
+		}
+		/* The migrants are passed on without being decoded. */
+		size_t exchange = generation / migration_interval_;
+		for (size_t i = 0; i < island_count_; ++i) {
+			if (!sockets[i]->Receive(MessageType::kMigrants, outgoing[i])) {
+				fail("Lost island " + std::to_string(i));
+			}
+		}
+		for (size_t i = 0; i < island_count_; ++i) {
+			if (!sockets[i]->Send(MessageType::kMigrants,
+								  outgoing[GetSource(i, exchange)])) {
+				fail("Lost island " + std::to_string(i));
+			}
+		}
+	}
+
+	for (size_t i = 0; i < island_count_; ++i) {
+		int status;
+		if (waitpid(workers[i], &status, 0) != workers[i] ||
+			!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+			std::cerr << "The worker of island " << i << " failed";
+			std::cerr << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+void IslandModel::RunWorker(size_t island, size_t generation_count) {
+	typedef MigrationSocket::MessageType MessageType;
+	MigrationSocket socket;
+	std::string payload;
+	uint64_t seed;
+	size_t position = 0;
+	AppendVarint(payload, island);
+	if (!socket.Connect(opts_.island_socket_) ||
+		!socket.Send(MessageType::kHello, payload) ||
+		!socket.Receive(MessageType::kHello, payload) ||
+		!ReadVarint(payload, position, seed)) {
+		std::cerr << "Island " << island << " couldn't join the run";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	rng_ = Rng(seed);
+	auto fail = [island]() {
+		std::cerr << "Island " << island << " lost the coordinator";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	};
+
+	Observer report = [&](size_t /* island */,
+						  const Statistics &statistics) {
+		payload.clear();
+		AppendDouble(payload, statistics.best_fitness);
+		AppendDouble(payload, statistics.avg_fitness);
+		AppendVarint(payload, statistics.best_size);
+		AppendVarint(payload, statistics.avg_size);
+		if (!socket.Send(MessageType::kStatistics, payload)) {
+			fail();
+		}
+	};
+	Exchange by_socket = [&](size_t /* island */, size_t /* exchange */,
+							 Migrants &migrants) {
+		payload.clear();
+		AppendVarint(payload, migrants.size());
+		for (Individual &migrant : migrants) {
+			migrant.Encode(payload);
+		}
+		if (!socket.Send(MessageType::kMigrants, payload) ||
+			!socket.Receive(MessageType::kMigrants, payload)) {
+			fail();
+		}
+		uint64_t count;
+		size_t position = 0;
+		/* Every individual takes a few bytes, which bounds a bad count. */
+		if (!ReadVarint(payload, position, count) ||
+			count > payload.size()) {
+			fail();
+		}
+		migrants.resize(count);
+		for (Individual &migrant : migrants) {
+			if (!migrant.Decode(payload, position, opts_.linear_genome_)) {
+				std::cerr << "Island " << island << " received a bad ";
+				std::cerr << "individual" << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+	};
+	RunIsland(island, generation_count, report, by_socket);
+	socket.Close();
+}
+std::string IslandModel::GetSocketPath() {
+	if (!opts_.island_socket_.empty()) {
+		return opts_.island_socket_;
+	}
+	return "/tmp/santafe-islands-" + std::to_string(getpid()) + ".sock";
+}
+#else
+bool IslandModel::IsProcessSupported() {
+	return false;
+}
+void IslandModel::RunProcesses(size_t /* generation_count */,
+							   const std::vector<std::string> & /* arguments */,
+							   const Observer & /* observer */) {
+	std::cerr << "Islands can't run as processes on this platform";
+	std::cerr << std::endl;
+	exit(EXIT_FAILURE);
+}
+void IslandModel::RunWorker(size_t /* island */,
+							size_t /* generation_count */) {
+	std::cerr << "Islands can't run as processes on this platform";
+	std::cerr << std::endl;
+	exit(EXIT_FAILURE);
+}
+#endif
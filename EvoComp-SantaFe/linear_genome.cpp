@@ -0,0 +1,296 @@
+/*
+ * linear_genome.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "linear_genome.h"
+#include <iostream> /* Logging/error reporting only */
+#include "encoding.h"
+#include "hash.h"
+
+void LinearGenome::Generate(size_t max_depth, bool full_tree, Rng &rng) {
+	ops_.clear();
+	AppendRandomSubtree(ops_, 0, max_depth, full_tree, rng);
+	CalculateExtents();
+}
+void LinearGenome::Mutate(double mutation_chance, size_t max_depth,
+						  Rng &rng) {
+	const size_t kMinimumTreeIncrease = 3;
+	/*
+	 * The scratch buffers are kept per thread, and the old genome is swapped
+	 * into `mutated`, so mutating doesn't allocate once they have grown.
+	 */
+	static thread_local std::vector<uint8_t> mutations;
+	static thread_local std::vector<uint8_t> mutated;
+	static thread_local std::vector<size_t> pending;
+	mutations.resize(ops_.size());
+	rng.FillBernoulli(mutation_chance, mutations.size(), mutations.data());
+
+	/*
+	 * Copy the genome in prefix order, replacing the subtree of every node
+	 * that mutates.  `pending` holds how many children each unfinished
+	 * ancestor still needs, so its size is the depth of the next node.
+	 */
+	mutated.clear();
+	pending.clear();
+	mutated.reserve(ops_.size());
+	size_t i = 0;
+	while (i < ops_.size()) {
+		size_t depth = pending.size();
+		OpType op = static_cast<OpType>(ops_[i]);
+		bool complete = true;
+		if (mutations[i]) {
+			OpType lower_bound, upper_bound;
+			if (GetArity(op) == 0) {
+				lower_bound = OpType::kMoveForward;
+				upper_bound = OpType::kTurnRight;
+			} else {
+				lower_bound = OpType::kProg3;
+				upper_bound = OpType::kIfFoodAhead;
+			}
+			op = static_cast<OpType>(lower_bound + rng.NextBounded(
+				upper_bound - lower_bound + 1));
+			mutated.push_back(static_cast<uint8_t>(op));
+			size_t adjusted_depth = max_depth;
+			if (adjusted_depth < depth) {
+				adjusted_depth = depth + kMinimumTreeIncrease;
+			}
+			for (size_t c = 0; c < GetArity(op); ++c) {
+				AppendRandomSubtree(mutated, depth + 1, adjusted_depth, false,
+									rng);
+			}
+			i += extents_[i];
+		} else {
+			mutated.push_back(ops_[i]);
+			if (GetArity(op) != 0) {
+				pending.push_back(GetArity(op));
+				complete = false;
+			}
+			++i;
+		}
+		while (complete && !pending.empty()) {
+			complete = (--pending.back() == 0);
+			if (complete) {
+				pending.pop_back();
+			}
+		}
+	}
+	ops_.swap(mutated);
+	CalculateExtents();
+}
+void LinearGenome::Splice(size_t position, const LinearGenome &donor,
+						  size_t donor_position) {
+	static thread_local std::vector<uint8_t> spliced;
+	spliced.clear();
+	size_t donor_end = donor_position + donor.extents_[donor_position];
+	spliced.reserve(ops_.size() - extents_[position] +
+					donor.extents_[donor_position]);
+	spliced.insert(spliced.end(), ops_.begin(), ops_.begin() + position);
+	spliced.insert(spliced.end(), donor.ops_.begin() + donor_position,
+				   donor.ops_.begin() + donor_end);
+	spliced.insert(spliced.end(), ops_.begin() + position + extents_[position],
+				   ops_.end());
+	ops_.swap(spliced);
+	CalculateExtents();
+}
+size_t LinearGenome::SelectPosition(size_t countdown,
+									bool nonterminal) const {
+	for (size_t i = 0; i < ops_.size(); ++i) {
+		if ((GetArity(static_cast<OpType>(ops_[i])) != 0) == nonterminal) {
+			if (countdown == 0) {
+				return i;
+			}
+			--countdown;
+		}
+	}
+	std::cerr << "No node left to select!" << std::endl;
+	exit(EXIT_FAILURE);
+}
+void LinearGenome::CountNodes(size_t &term_count,
+							  size_t &nonterm_count) const {
+	for (uint8_t op : ops_) {
+		if (GetArity(static_cast<OpType>(op)) != 0) {
+			++nonterm_count;
+		} else {
+			++term_count;
+		}
+	}
+}
+uint64_t LinearGenome::Hash() const {
+	/*
+	 * Walking backwards, the hashes of a node's children are on top of the
+	 * stack by the time the node is reached, first child uppermost.
+	 */
+	static thread_local std::vector<uint64_t> stack;
+	stack.clear();
+	for (size_t i = ops_.size(); i-- > 0;) {
+		uint64_t hash = HashCombine(0, ops_[i]);
+		for (size_t c = GetArity(static_cast<OpType>(ops_[i])); c > 0; --c) {
+			hash = HashCombine(hash, stack.back());
+			stack.pop_back();
+		}
+		stack.push_back(hash);
+	}
+	return stack.empty() ? 0 : stack.back();
+}
+std::string LinearGenome::ToString(bool /* latex */) const {
+	std::string text;
+	if (!ops_.empty()) {
+		AppendString(0, text);
+	}
+	return text;
+}
+Node* LinearGenome::ToTree() const {
+	return BuildNode(0);
+}
+void LinearGenome::FromTree(Node *root) {
+	ops_.clear();
+	AppendNode(root);
+	CalculateExtents();
+}
+void LinearGenome::Encode(std::string &bytes) const {
+	for (uint8_t op : ops_) {
+		AppendEncodedNode(bytes, static_cast<OpType>(op),
+				   GetArity(static_cast<OpType>(op)));
+	}
+}
+bool LinearGenome::Decode(const std::string &bytes, size_t &position) {
+	static thread_local std::vector<uint8_t> decoded;
+	decoded.clear();
+	/* The number of nodes still to read, which the root starts at one. */
+	size_t pending = 1;
+	size_t end = position;
+	while (pending > 0) {
+		OpType op;
+		size_t child_count;
+		if (!ReadEncodedNode(bytes, end, op, child_count) ||
+			child_count != GetArity(op)) {
+			return false;
+		}
+		decoded.push_back(static_cast<uint8_t>(op));
+		pending += child_count - 1;
+	}
+	ops_.assign(decoded.begin(), decoded.end());
+	CalculateExtents();
+	position = end;
+	return true;
+}
+size_t LinearGenome::GetArity(OpType op) {
+	switch (op) {
+	case OpType::kProg3:
+		return 3;
+	case OpType::kProg2:
+	case OpType::kIfFoodAhead:
+		return 2;
+	default:
+		return 0;
+	}
+}
+void LinearGenome::AppendRandomSubtree(std::vector<uint8_t> &ops,
+									   size_t cur_depth, size_t max_depth,
+									   bool full_tree, Rng &rng) {
+	OpType lower_bound, upper_bound;
+	if (full_tree) {
+		lower_bound = OpType::kProg3;
+		upper_bound = OpType::kIfFoodAhead;
+	} else {
+		lower_bound = OpType::kProg3;
+		upper_bound = OpType::kTurnRight;
+	}
+	if (cur_depth >= max_depth) {
+		lower_bound = OpType::kMoveForward;
+		upper_bound = OpType::kTurnRight;
+	}
+	OpType op = static_cast<OpType>(lower_bound +
+									rng.NextBounded(upper_bound -
+													lower_bound + 1));
+	ops.push_back(static_cast<uint8_t>(op));
+	for (size_t c = 0; c < GetArity(op); ++c) {
+		AppendRandomSubtree(ops, cur_depth + 1, max_depth, full_tree, rng);
+	}
+}
+void LinearGenome::CalculateExtents() {
+	/* As in Hash(), the children's sizes are on the stack in order. */
+	static thread_local std::vector<uint32_t> stack;
+	stack.clear();
+	extents_.resize(ops_.size());
+	for (size_t i = ops_.size(); i-- > 0;) {
+		uint32_t extent = 1;
+		for (size_t c = GetArity(static_cast<OpType>(ops_[i])); c > 0; --c) {
+			extent += stack.back();
+			stack.pop_back();
+		}
+		extents_[i] = extent;
+		stack.push_back(extent);
+	}
+}
+void LinearGenome::AppendString(size_t position, std::string &text) const {
+	size_t child = position + 1;
+	switch (static_cast<OpType>(ops_[position])) {
+	case OpType::kProg3:
+	case OpType::kProg2:
+		for (size_t c = 0; c < GetArity(GetOperator(position)); ++c) {
+			text += (c == 0) ? "(" : " (";
+			AppendString(child, text);
+			text += ")";
+			child += extents_[child];
+		}
+		break;
+	case OpType::kIfFoodAhead:
+		text += "{";
+		AppendString(child, text);
+		text += "} {";
+		AppendString(child + extents_[child], text);
+		text += "}";
+		break;
+	case OpType::kMoveForward:
+		text += "^";
+		break;
+	case OpType::kTurnLeft:
+		text += "<";
+		break;
+	case OpType::kTurnRight:
+		text += ">";
+		break;
+	default:
+		text += "!";
+		break;
+	}
+}
+Node* LinearGenome::BuildNode(size_t position) const {
+	Node *node = Node::Create();
+	node->op_ = GetOperator(position);
+	uint32_t *link = &node->first_child_;
+	size_t child = position + 1;
+	for (size_t c = 0; c < GetArity(node->op_); ++c) {
+		Node *built = BuildNode(child);
+		*link = built->index_;
+		link = &built->next_sibling_;
+		child += extents_[child];
+	}
+	node->UpdateCounts();
+	return node;
+}
+void LinearGenome::AppendNode(Node *node) {
+	ops_.push_back(static_cast<uint8_t>(node->op_));
+	Node *child = node->GetChild(0);
+	for (size_t c = 0; c < GetArity(node->op_); ++c) {
+		AppendNode(child);
+		child = child->GetNextSibling();
+	}
+}
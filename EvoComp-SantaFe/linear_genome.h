@@ -0,0 +1,152 @@
+/*
+ * linear_genome.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "node.h"
+#include "operator_types.h"
+#include "rng.h"
+
+/**
+ * @class	LinearGenome
+ * A solution tree stored as the operators of its nodes in prefix order,
+ * alongside the number of nodes in the subtree starting at each position.
+ * Every subtree is a contiguous range, so crossover is a range copy,
+ * mutation rewrites ranges while copying the array once, and every
+ * traversal walks memory in order instead of chasing pointers.
+ *
+ * Unlike a `Node` tree, every nonterminal has exactly the arity of its
+ * operator.  Trees are converted to and from this form by `ToTree()` and
+ * `FromTree()`, and a genome hashes to the same value as the equivalent
+ * tree, so both forms share the fitness cache.
+ */
+class LinearGenome {
+public:
+	/**
+	 * Replace the genome with a random tree, drawn the same way as
+	 * `Node::GenerateTree()`.
+	 *
+	 * @param[in]	max_depth	Depth at which only terminals are drawn.
+	 * @param[in]	full_tree	Only draw nonterminals until `max_depth`.
+	 * @param[in]	rng			The generator to draw operators from.
+	 */
+	void Generate(size_t max_depth, bool full_tree, Rng &rng);
+	/**
+	 * Give each node a `mutation_chance` chance of changing its operator to
+	 * another of the same kind, the same way as `Node::Mutate()`.  A
+	 * nonterminal that mutates gets new random children in place of its
+	 * old subtree.
+	 *
+	 * @param[in]	mutation_chance		The chance that a node mutates.
+	 * @param[in]	max_depth			Max tree depth to help curb code
+	 *									growth.
+	 * @param[in]	rng					The generator to draw from.
+	 */
+	void Mutate(double mutation_chance, size_t max_depth, Rng &rng);
+	/**
+	 * Replace the subtree at `position` with a copy of the subtree of
+	 * `donor` at `donor_position`.  `donor` may be this genome.
+	 */
+	void Splice(size_t position, const LinearGenome &donor,
+				size_t donor_position);
+	/**
+	 * Return the position of the node that is the `countdown`th terminal,
+	 * or nonterminal, in prefix order.
+	 */
+	size_t SelectPosition(size_t countdown, bool nonterminal) const;
+	/** Count the terminal and nonterminal nodes. */
+	void CountNodes(size_t &term_count, size_t &nonterm_count) const;
+	/** Return the same structural hash as `Node::Hash()` on the tree. */
+	uint64_t Hash() const;
+	/** Return the same text as `Node::ToString()` on the tree. */
+	std::string ToString(bool latex) const;
+	/** Build the tree in the current `NodeArena`. */
+	Node* ToTree() const;
+	/**
+	 * Replace the genome with the tree under `root`.  Extra children that
+	 * crossover linked onto a tree node are left out, as they can't be
+	 * represented.
+	 */
+	void FromTree(Node *root);
+	/**
+	 * Append the nodes in prefix order to `bytes`, in the encoding of
+	 * `encoding.h`.  It is the same as the one `SharedTree::Encode()` gives
+	 * for the same tree.
+	 */
+	void Encode(std::string &bytes) const;
+	/**
+	 * Replace the genome with one written by `Encode()`, read from `bytes`
+	 * at `position`, and move `position` past it.
+	 *
+	 * @return	False, leaving the genome as it was, if the tree isn't
+	 *			valid or a node's children don't match its operator.
+	 */
+	bool Decode(const std::string &bytes, size_t &position);
+	/** Exchange the contents with another genome. */
+	void Swap(LinearGenome &other) noexcept {
+		ops_.swap(other.ops_);
+		extents_.swap(other.extents_);
+	}
+	/** Return the number of nodes. */
+	size_t GetSize() const {
+		return ops_.size();
+	}
+	/** Return the number of bytes held for the genome, used or not. */
+	size_t GetReservedBytes() const {
+		return ops_.capacity() * sizeof(uint8_t) +
+			   extents_.capacity() * sizeof(uint32_t);
+	}
+	/** Return the operator of the node at `position`. */
+	OpType GetOperator(size_t position) const {
+		return static_cast<OpType>(ops_[position]);
+	}
+	/** Return the number of nodes in the subtree starting at `position`. */
+	size_t GetSubtreeSize(size_t position) const {
+		return extents_[position];
+	}
+	/** Return the number of children a node with operator `op` has. */
+	static size_t GetArity(OpType op);
+
+private:
+	/**
+	 * Append a random subtree to `ops`, drawn the same way as
+	 * `Node::GenerateTree()`.  Subtree sizes aren't filled in.
+	 */
+	static void AppendRandomSubtree(std::vector<uint8_t> &ops,
+									size_t cur_depth, size_t max_depth,
+									bool full_tree, Rng &rng);
+	/** Recompute `extents_` from `ops_` in one backwards pass. */
+	void CalculateExtents();
+	/** Append the text of the subtree at `position` to `text`. */
+	void AppendString(size_t position, std::string &text) const;
+	/** Build the tree for the subtree at `position`. */
+	Node* BuildNode(size_t position) const;
+	/** Append the operators of the subtree under `node`. */
+	void AppendNode(Node *node);
+
+	std::vector<uint8_t> ops_; /**< `OpType` of each node in prefix order. */
+	std::vector<uint32_t> extents_; /**< Size of each node's subtree. */
+};
@@ -34,13 +34,19 @@
  */
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <boost/program_options.hpp>
+#include "classic_trails.h"
+#include "fitness_cache.h"
+#include "island_model.h"
+#include "map_definition.h"
+#include "memory_usage.h"
 #include "options.h"
 #include "population.h"
-#include "trail_map.h"
+#include "thread_pool.h"
 namespace po = boost::program_options;
 
 /**
@@ -62,12 +68,20 @@ namespace po = boost::program_options;
  std::string GetUsageString(std::string program_name);
  /** 
   * Returns a vector of the lines in the given file.  This is passed to the
-  * TrailMap to construct a new map object.
+  * MapDefinition to construct a new map object.
   * @param[in]	filename	Name of the file to parse.
   * @return	Returns a `std::vector<std::string>` containing the
   *			contents of the file read in.
   */
 std::vector<std::string> ParseDataFile(std::string filename);
+/**
+ * Returns the map definition for the given file.  Each file is only parsed
+ * once; every map set that names the same file shares the same read-only
+ * definition.
+ * @param[in]	filename	Name of the map file.
+ * @return	Returns a pointer to the shared `MapDefinition`.
+ */
+const MapDefinition* GetMapDefinition(std::string filename);
 /** 
  * Return a string formatted to write to file.
  *
@@ -81,6 +95,40 @@ std::vector<std::string> ParseDataFile(std::string filename);
  */
 std::string FormatOutput(double best_fitness, double avg_fitness,
 							 size_t best_solution_size, size_t avg_size);
+/**
+ * Evolve the islands of an island model, writing the rows of each island
+ * to its own file and a summary of all of them to the output file.
+ *
+ * @param[in]	maps			The maps the islands evolve on.
+ * @param[in]	fitness_cache	Cache shared by the islands, or `nullptr`.
+ * @param[in]	arguments		The command line, for worker processes.
+ *
+ * @return	The population of each island, with its own output file, or
+ *			nothing if the islands were worker processes.
+ */
+std::vector<std::pair<Population*,std::ofstream*>> EvolveIslands(
+	std::vector<const MapDefinition*> maps, FitnessCache *fitness_cache,
+	const std::vector<std::string> &arguments);
+/**
+ * Return the name of the output file of an island, which is `filename`
+ * with `_island<island>` inserted before its extension.
+ */
+std::string GetIslandFileName(std::string filename, size_t island);
+/** Return the column names of the rows from `FormatMemoryOutput()`. */
+std::string FormatMemoryHeader();
+/**
+ * Return a row of the memory usage file.
+ *
+ * @param[in]	generation	Number of generations evolved so far.
+ * @param[in]	population	Position of the population in the run, 0 for
+ *							the main population and 1 for the secondary.
+ * @param[in]	usage		The memory usage of the population.
+ *
+ * @return	The parameters separated by commas and formatted as
+ *			a `std::string`.
+ */
+std::string FormatMemoryOutput(size_t generation, size_t population,
+							   const MemoryUsage &usage);
 /* 
  * All of the command line options are stored in this object and this object
  * is passed where needed to read the options.
@@ -90,74 +138,129 @@ static Options opts;
 int main(int argc, char **argv, char **envp) {
 	ParseCommandLine(argc, argv, opts);
 
-	std::vector<TrailMap*> maps;
-	std::vector<TrailMap*> secondary_maps;
-	std::vector<TrailMap*> verification_maps;
+	std::vector<const MapDefinition*> maps;
+	std::vector<const MapDefinition*> secondary_maps;
+	std::vector<const MapDefinition*> verification_maps;
 	std::vector<std::pair<Population*,std::ofstream*>> populations;
+	FitnessCache *fitness_cache = nullptr;
+	ThreadPool thread_pool(opts.thread_count_);
 
 	/* Create all the maps */
 	for (std::string fn : opts.map_files_) {
-		maps.emplace_back(new TrailMap(ParseDataFile(fn), 
-								   opts.action_count_limit_));
+		maps.emplace_back(GetMapDefinition(fn));
 	}
 	if (opts.secondary_maps_exist_) {
 		for (std::string fn : opts.secondary_map_files_) {
-			secondary_maps.emplace_back(new TrailMap(ParseDataFile(fn), 
-												 opts.action_count_limit_));
+			secondary_maps.emplace_back(GetMapDefinition(fn));
 		}
 	}
 	if (opts.verification_maps_exist_) {
 		for (std::string fn : opts.verification_map_files_) {
-			verification_maps.emplace_back(new TrailMap(ParseDataFile(fn),
-													opts.action_count_limit_));
+			verification_maps.emplace_back(GetMapDefinition(fn));
 		}
 	}
 
-	/* Create the populations */
-	populations.emplace_back(
-		std::make_pair(new Population(opts, maps),
-					   new std::ofstream(opts.output_file_,
-										 std::ios::out | std::ios::trunc)));
-	if (!populations.back().second->is_open()) {
-		std::cerr << "Could not open output file: ";
-		std::cerr << opts.output_file_ << std::endl;
-		exit(EXIT_FAILURE);
+	/* Share one fitness cache between all of the populations */
+	if (opts.fitness_cache_) {
+		fitness_cache = new FitnessCache;
+		if (!opts.fitness_cache_file_.empty()) {
+			fitness_cache->Load(opts.fitness_cache_file_);
+		}
 	}
-	if (opts.secondary_maps_exist_) {
+
+	/* A worker process evolves one island and leaves the output to others */
+	if (opts.island_worker_) {
+		IslandModel island_model(opts, maps, fitness_cache);
+		island_model.RunWorker(opts.island_index_, opts.evolution_count_);
+		return(EXIT_SUCCESS);
+	}
+
+	/* Islands evolve on their own threads, see `EvolveIslands()` */
+	if (opts.island_count_ > 0) {
+		populations = EvolveIslands(maps, fitness_cache,
+									std::vector<std::string>(argv,
+															 argv + argc));
+	} else {
+		/* Create the populations */
 		populations.emplace_back(
-			std::make_pair(new Population(*(populations.front().first), 
-										  secondary_maps),
-						   new std::ofstream(opts.secondary_output_file_, 
-											 std::ios::out | 
-											 std::ios::trunc)));
+			std::make_pair(new Population(opts, maps, fitness_cache,
+										  &thread_pool),
+						   new std::ofstream(opts.output_file_,
+											 std::ios::out | std::ios::trunc)));
 		if (!populations.back().second->is_open()) {
 			std::cerr << "Could not open output file: ";
-			std::cerr << opts.secondary_output_file_ << std::endl;
+			std::cerr << opts.output_file_ << std::endl;
 			exit(EXIT_FAILURE);
 		}
-	}
+		std::clog << "Seed: " << populations.back().first->GetSeed() << "\n";
+		if (opts.secondary_maps_exist_) {
+			populations.emplace_back(
+				std::make_pair(new Population(*(populations.front().first), 
+											  secondary_maps),
+							   new std::ofstream(opts.secondary_output_file_, 
+												 std::ios::out | 
+												 std::ios::trunc)));
+			if (!populations.back().second->is_open()) {
+				std::cerr << "Could not open output file: ";
+				std::cerr << opts.secondary_output_file_ << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
 
-	/* Evolve the populations in tandem */
-	for (size_t i = 0; i < opts.evolution_count_; ++i) {
-		for (auto p : populations) {
-			p.first->Evolve();
-			(*p.second) << FormatOutput(p.first->GetBestFitness(), 
-									 p.first->GetAverageFitness(), 
-									 p.first->GetBestTreeSize(), 
-									 p.first->GetAverageTreeSize());
-			(*p.second) << "\n";
-			std::clog << "Generation " << i << " completed.\n";
-			if (i % 100 == 0) {
-				std::clog << "Current best solution: \n";
-				std::clog << FormatOutput(p.first->GetBestFitness(),
-										  p.first->GetAverageFitness(),
-										  p.first->GetBestTreeSize(),
-										  p.first->GetAverageTreeSize());
-				std::clog << "\n";
-				//std::clog << p.first->GetBestSolutionGraphViz();
-				//std::clog << "\n";
+		/*
+		 * Memory usage is written for the initial populations and each
+		 * generation
+		 */
+		std::ofstream memory_output_file;
+		if (!opts.memory_output_file_.empty()) {
+			memory_output_file.open(opts.memory_output_file_,
+									std::ios::out | std::ios::trunc);
+			if (!memory_output_file.is_open()) {
+				std::cerr << "Could not open output file: ";
+				std::cerr << opts.memory_output_file_ << std::endl;
+				exit(EXIT_FAILURE);
+			}
+			memory_output_file << FormatMemoryHeader() << "\n";
+			for (size_t j = 0; j < populations.size(); ++j) {
+				memory_output_file << FormatMemoryOutput(
+					0, j, populations[j].first->GetMemoryUsage()) << "\n";
+			}
+		}
+
+		/* Evolve the populations in tandem */
+		for (size_t i = 0; i < opts.evolution_count_; ++i) {
+			for (auto p : populations) {
+				p.first->Evolve();
+				(*p.second) << FormatOutput(p.first->GetBestFitness(), 
+										 p.first->GetAverageFitness(), 
+										 p.first->GetBestTreeSize(), 
+										 p.first->GetAverageTreeSize());
+				(*p.second) << "\n";
+				std::clog << "Generation " << i << " completed, ";
+				std::clog << p.first->GetStepsSaved() << " steps saved, ";
+				std::clog << p.first->GetCacheHitCount() << " cache hits, ";
+				std::clog << p.first->GetSimplifiedNodeCount();
+				std::clog << " nodes simplified.\n";
+				if (i % 100 == 0) {
+					std::clog << "Current best solution: \n";
+					std::clog << FormatOutput(p.first->GetBestFitness(),
+											  p.first->GetAverageFitness(),
+											  p.first->GetBestTreeSize(),
+											  p.first->GetAverageTreeSize());
+					std::clog << "\n";
+					//std::clog << p.first->GetBestSolutionGraphViz();
+					//std::clog << "\n";
+				}
+			}
+			if (memory_output_file.is_open()) {
+				for (size_t j = 0; j < populations.size(); ++j) {
+					memory_output_file << FormatMemoryOutput(
+						i + 1, j, populations[j].first->GetMemoryUsage());
+					memory_output_file << "\n";
+				}
 			}
 		}
+		memory_output_file.close();
 	}
 	for (auto p : populations) {
 		p.second->close();
@@ -191,6 +294,10 @@ int main(int argc, char **argv, char **envp) {
 		verification_output_file.close();
 	}
 
+	if (fitness_cache && !opts.fitness_cache_file_.empty()) {
+		fitness_cache->Save(opts.fitness_cache_file_);
+	}
+
 	return(EXIT_SUCCESS);
 }
 void ParseCommandLine(int argc, char **argv, Options &opts) {
@@ -223,7 +330,63 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 		 "Number of Individuals in a tournament.")
 		("proportional-tournament-rate,r",
 		 po::value<double>(&opts.proportional_tournament_rate_),
-		 "Rate that tournament is fitness based instead of parsimony based.");
+		 "Rate that tournament is fitness based instead of parsimony based.")
+		("elitism,k",
+		 po::value<size_t>(&opts.elitism_count_),
+		 "Number of best Individuals carried into each next generation.")
+		("steady-state,y",
+		 po::bool_switch(&opts.steady_state_),
+		 "Replace the losers of reverse tournaments one child at a time "
+		 "instead of evolving whole generations.")
+		("batch-evaluation,b",
+		 po::bool_switch(&opts.batch_evaluation_),
+		 "Evaluate many individuals against a map in lockstep.")
+		("linear-genome,l",
+		 po::bool_switch(&opts.linear_genome_),
+		 "Store each tree as a flat prefix-order array instead of nodes.")
+		("shared-trees,u",
+		 po::bool_switch(&opts.shared_trees_),
+		 "Store each tree in a table of shared, immutable subtrees.")
+		("fitness-cache,c",
+		 po::bool_switch(&opts.fitness_cache_),
+		 "Reuse the scores of structurally identical trees.")
+		("simplify,s",
+		 po::value<size_t>(&opts.simplify_interval_),
+		 "Simplify every tree once every N generations (0 disables).")
+		("threads,j",
+		 po::value<size_t>(&opts.thread_count_),
+		 "Number of threads to make and evaluate individuals on (0 uses one "
+		 "per hardware thread).")
+		("seed,e",
+		 po::value<uint64_t>(&opts.seed_),
+		 "Seed of every random decision, to repeat a run (0 picks one).")
+		("islands,i",
+		 po::value<size_t>(&opts.island_count_),
+		 "Number of populations to evolve on threads of their own, "
+		 "exchanging individuals (0 evolves a single population).")
+		("migration-interval",
+		 po::value<size_t>(&opts.migration_interval_),
+		 "Generations between exchanges of individuals between islands "
+		 "(0 disables migration).")
+		("migration-size",
+		 po::value<size_t>(&opts.migration_size_),
+		 "Number of best Individuals each island sends per exchange.")
+		("migration-topology",
+		 po::value<std::string>(&opts.migration_topology_),
+		 "Islands send to the next island in a \"ring\" or to a "
+		 "\"random\" one each exchange.")
+		("island-processes",
+		 po::bool_switch(&opts.island_processes_),
+		 "Evolve each island in a worker process of its own, exchanging "
+		 "individuals over a local socket.")
+		("island-socket",
+		 po::value<std::string>(&opts.island_socket_),
+		 "Path of the socket the worker processes connect to (a temporary "
+		 "one by default).")
+		("island-worker",
+		 po::value<size_t>(&opts.island_index_),
+		 "Evolve this island as a worker process of the run whose "
+		 "coordinator listens at --island-socket.");
 	/*Individual Options */
 	indiv_opts.add_options()
 		("mutation,m", 
@@ -242,7 +405,8 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 	io_opts.add_options()
 		("input,I",
 		 po::value<std::vector<std::string>>(&opts.map_files_)->required(),
-		 "Specify input file(s)")
+		 "Specify input file(s), or classic:muir / classic:urbano for an "
+		 "embedded trail")
 		("secondary,S",
 		 po::value<std::vector<std::string>>(&opts.secondary_map_files_),
 		 "Secondary set of input file(s) to compare against.")
@@ -259,7 +423,15 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 		 "Output file for secondary GP population.")
 		("verification-output,W",
 		 po::value<std::string>(&opts.verification_output_file_),
-		 "Output file for verification GP population.");
+		 "Output file for verification GP population.")
+		("memory-output,M",
+		 po::value<std::string>(&opts.memory_output_file_),
+		 "Write the memory usage of each population every generation to "
+		 "this file.")
+		("fitness-cache-file,C",
+		 po::value<std::string>(&opts.fitness_cache_file_),
+		 "Load and save the fitness cache in this file.  Implies "
+		 "--fitness-cache.");
 	/* All unspecified options are treated as input files */
 	positional_opts.add("input", -1);
 
@@ -296,7 +468,7 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 
 	if (vm.count("input")) {
 		for (auto fn : opts.map_files_) {
-			if (!(std::ifstream(fn).good())) {
+			if (!IsClassicTrail(fn) && !(std::ifstream(fn).good())) {
 				std::cerr << fn << " not found!" << std::endl;
 				exit(EXIT_FAILURE);
 			}
@@ -310,7 +482,7 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 
 	if (vm.count("secondary")) {
 		for (auto fn : opts.secondary_map_files_) {
-			if (!(std::ifstream(fn).good())) {
+			if (!IsClassicTrail(fn) && !(std::ifstream(fn).good())) {
 				std::cerr << fn << " not found!" << std::endl;
 				exit(EXIT_FAILURE);
 			}
@@ -322,7 +494,7 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 
 	if (vm.count("verification")) {
 		for (auto fn : opts.verification_map_files_) {
-			if (!(std::ifstream(fn).good())) {
+			if (!IsClassicTrail(fn) && !(std::ifstream(fn).good())) {
 				std::cerr << fn << " not found!" << std::endl;
 				exit(EXIT_FAILURE);
 			}
@@ -332,11 +504,53 @@ void ParseCommandLine(int argc, char **argv, Options &opts) {
 		opts.verification_maps_exist_ = false;
 	}
 
+	if (opts.linear_genome_ && opts.shared_trees_) {
+		std::cerr << "--linear-genome and --shared-trees can't be combined";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	if (opts.island_count_ > 0 && (opts.secondary_maps_exist_ ||
+									!opts.memory_output_file_.empty())) {
+		std::cerr << "--islands can't be combined with --secondary or ";
+		std::cerr << "--memory-output" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (opts.island_processes_ && (opts.island_count_ == 0 ||
+								   vm.count("graphviz") ||
+								   opts.verification_maps_exist_)) {
+		std::cerr << "--island-processes needs --islands and can't be ";
+		std::cerr << "combined with --graphviz or --verification";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if ((opts.island_processes_ || vm.count("island-worker")) &&
+		!IslandModel::IsProcessSupported()) {
+		std::cerr << "--island-processes is only supported on Linux";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	opts.island_worker_ = (vm.count("island-worker") != 0);
+	if (opts.island_worker_ && opts.island_socket_.empty()) {
+		std::cerr << "--island-worker needs --island-socket" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (opts.migration_topology_ != "ring" &&
+		opts.migration_topology_ != "random") {
+		std::cerr << "Unknown migration topology: ";
+		std::cerr << opts.migration_topology_ << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
 	if (vm.count("graphviz")) {
 		opts.graphviz_output_ = true;
 	} else {
 		opts.graphviz_output_ = false;
 	}
+
+	if (vm.count("fitness-cache-file")) {
+		opts.fitness_cache_ = true;
+	}
 }
 std::string GetUsageString(std::string program_name) {
 	size_t found = program_name.find_last_of("/\\");
@@ -362,10 +576,140 @@ std::vector<std::string> ParseDataFile(std::string filename) {
 	}
 	return map_file_contents;
 }
+const MapDefinition* GetMapDefinition(std::string filename) {
+	static std::map<std::string, const MapDefinition*> definitions;
+	auto it = definitions.find(filename);
+	if (it == definitions.end()) {
+		std::vector<std::string> map_file = IsClassicTrail(filename) ?
+			GetClassicTrail(filename) : ParseDataFile(filename);
+		it = definitions.emplace(filename, new MapDefinition(
+			map_file, opts.action_count_limit_)).first;
+	}
+	return it->second;
+}
 std::string FormatOutput(double best_fitness, double avg_fitness, 
 					  size_t best_solution_size, size_t avg_size) {
 	std::stringstream ss;
 	ss << best_fitness << "," << best_solution_size << ",";
 	ss << avg_fitness << "," << avg_size;
 	return ss.str();
+}
+std::vector<std::pair<Population*,std::ofstream*>> EvolveIslands(
+	std::vector<const MapDefinition*> maps, FitnessCache *fitness_cache,
+	const std::vector<std::string> &arguments) {
+	/* The rows an island wrote each generation, for the summary */
+	typedef IslandModel::Statistics Row;
+	std::vector<std::pair<Population*,std::ofstream*>> populations;
+	std::vector<std::ofstream*> output_files;
+	std::vector<std::vector<Row>> rows(opts.island_count_);
+	IslandModel *island_model = new IslandModel(opts, maps, fitness_cache);
+	std::clog << "Seed: " << island_model->GetSeed() << "\n";
+
+	for (size_t i = 0; i < opts.island_count_; ++i) {
+		std::string filename = GetIslandFileName(opts.output_file_, i);
+		output_files.emplace_back(
+			new std::ofstream(filename, std::ios::out | std::ios::trunc));
+		if (!output_files.back()->is_open()) {
+			std::cerr << "Could not open output file: ";
+			std::cerr << filename << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* Each island only touches its own file and rows */
+	IslandModel::Observer observer = [&](size_t island, const Row &row) {
+		rows[island].push_back(row);
+		(*output_files[island]) << FormatOutput(row.best_fitness,
+												row.avg_fitness,
+												row.best_size,
+												row.avg_size);
+		(*output_files[island]) << "\n";
+	};
+	if (opts.island_processes_) {
+		island_model->RunProcesses(opts.evolution_count_, arguments,
+								   observer);
+	} else {
+		island_model->Run(opts.evolution_count_, observer);
+	}
+
+	/*
+	 * The summary has the best island's best individual and the averages
+	 * over the islands, which are all the same size.
+	 */
+	std::ofstream output_file(opts.output_file_,
+							  std::ios::out | std::ios::trunc);
+	if (!output_file.is_open()) {
+		std::cerr << "Could not open output file: ";
+		std::cerr << opts.output_file_ << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	for (size_t g = 0; g < opts.evolution_count_; ++g) {
+		Row summary = rows[0][g];
+		double avg_fitness = 0;
+		size_t avg_size = 0;
+		for (size_t i = 0; i < opts.island_count_; ++i) {
+			if (rows[i][g].best_fitness > summary.best_fitness) {
+				summary.best_fitness = rows[i][g].best_fitness;
+				summary.best_size = rows[i][g].best_size;
+			}
+			avg_fitness += rows[i][g].avg_fitness;
+			avg_size += rows[i][g].avg_size;
+		}
+		output_file << FormatOutput(summary.best_fitness,
+									avg_fitness / opts.island_count_,
+									summary.best_size,
+									avg_size / opts.island_count_);
+		output_file << "\n";
+	}
+	output_file.close();
+
+	/* The populations of worker processes are gone with the workers */
+	for (size_t i = 0; i < opts.island_count_; ++i) {
+		if (opts.island_processes_) {
+			output_files[i]->close();
+		} else {
+			populations.emplace_back(
+				std::make_pair(island_model->GetIsland(i), output_files[i]));
+		}
+	}
+	return populations;
+}
+std::string GetIslandFileName(std::string filename, size_t island) {
+	std::string suffix = "_island" + std::to_string(island);
+	size_t dot = filename.find_last_of('.');
+	size_t slash = filename.find_last_of("/\\");
+	if (dot == std::string::npos ||
+		(slash != std::string::npos && dot < slash)) {
+		return filename + suffix;
+	}
+	return filename.substr(0, dot) + suffix + filename.substr(dot);
+}
+std::string FormatMemoryHeader() {
+	const char *phases[NodeArena::kPhaseCount] = {
+		"init", "selection", "crossover", "mutation", "simplification",
+		"evaluation"
+	};
+	std::stringstream ss;
+	ss << "generation,population,live_nodes,node_bytes,arena_bytes,";
+	ss << "subtrees,subtree_bytes,genome_bytes,score_bytes,program_bytes,";
+	ss << "map_bytes";
+	for (const char *phase : phases) {
+		ss << "," << phase << "_allocs," << phase << "_frees";
+	}
+	ss << ",released,rss_bytes";
+	return ss.str();
+}
+std::string FormatMemoryOutput(size_t generation, size_t population,
+							   const MemoryUsage &usage) {
+	std::stringstream ss;
+	ss << generation << "," << population << "," << usage.live_nodes << ",";
+	ss << usage.node_bytes << "," << usage.arena_bytes << ",";
+	ss << usage.subtree_count << "," << usage.subtree_bytes << ",";
+	ss << usage.genome_bytes << "," << usage.score_bytes << ",";
+	ss << usage.program_bytes << "," << usage.map_bytes;
+	for (size_t phase = 0; phase < NodeArena::kPhaseCount; ++phase) {
+		ss << "," << usage.allocations[phase] << "," << usage.frees[phase];
+	}
+	ss << "," << usage.released << "," << usage.resident_bytes;
+	return ss.str();
 }
\ No newline at end of file
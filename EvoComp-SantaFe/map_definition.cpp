@@ -0,0 +1,186 @@
+/*
+ * map_definition.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "map_definition.h"
+#include <bitset>
+#include "hash.h"
+
+MapDefinition::MapDefinition(std::vector<std::string> map_file,
+							 size_t step_limit) :
+	action_count_limit_(step_limit), row_count_(map_file.size()),
+	column_count_(0) {
+
+	for (std::string s : map_file) {
+		if (s.length() > column_count_) {
+			column_count_ = s.length();
+		}
+	}
+
+	/* Parse the data */
+	size_t word_count = (row_count_ * column_count_ + 63) / 64;
+	food_.assign(word_count, 0);
+	visited_.assign(word_count, 0);
+	for (size_t i = 0; i < row_count_; ++i) {
+		for (size_t j = 0; j < column_count_; ++j) {
+			TrailData d = TrailData::kUnvisitedEmpty;
+			if (j < map_file[i].length()) {
+				d = ConvertCharToTrailData(map_file[i][j]);
+			}
+			SetCell(i, j, d);
+		}
+	}
+
+	/* Count the number of food on the map */
+	SetTotalFoodCount();
+	SetHash();
+}
+TrailData MapDefinition::GetCell(size_t row, size_t column) const {
+	size_t index = GetCellIndex(row, column);
+	if (TestBit(food_, index)) {
+		if (TestBit(visited_, index)) {
+			return TrailData::kVisitedFood;
+		}
+		return TrailData::kUnvisitedFood;
+	}
+	if (TestBit(visited_, index)) {
+		return TrailData::kVisitedEmpty;
+	}
+	return TrailData::kUnvisitedEmpty;
+}
+size_t MapDefinition::GetCellIndex(size_t row, size_t column) const {
+	/* Simplistic bounds enforcing/checking */
+	return (row % row_count_) * column_count_ + (column % column_count_);
+}
+bool MapDefinition::HasUneatenFood(size_t index) const {
+	return TestBit(food_, index) && !TestBit(visited_, index);
+}
+bool MapDefinition::HasFood(size_t index) const {
+	return TestBit(food_, index);
+}
+bool MapDefinition::IsVisited(size_t index) const {
+	return TestBit(visited_, index);
+}
+size_t MapDefinition::GetTotalFoodCount() const {
+	return total_food_;
+}
+size_t MapDefinition::GetInitialConsumedFoodCount() const {
+	return initial_consumed_food_;
+}
+size_t MapDefinition::GetRowCount() const {
+	return row_count_;
+}
+size_t MapDefinition::GetColumnCount() const {
+	return column_count_;
+}
+size_t MapDefinition::GetActionLimit() const {
+	return action_count_limit_;
+}
+uint64_t MapDefinition::GetHash() const {
+	return hash_;
+}
+size_t MapDefinition::GetReservedBytes() const {
+	return (food_.capacity() + visited_.capacity()) * sizeof(uint64_t);
+}
+char MapDefinition::ConvertTrailDataToChar(TrailData d) {
+	switch (d) {
+	case TrailData::kUnvisitedEmpty: 
+		return '_';
+	case TrailData::kUnvisitedFood: 
+		return '*';
+	case TrailData::kVisitedEmpty: 
+		return 'x';
+	case TrailData::kVisitedFood: 
+		return 'X';
+	}
+	return '?';
+}
+TrailData MapDefinition::ConvertCharToTrailData(char c) {
+	switch (c) {
+	case '_':
+		return TrailData::kUnvisitedEmpty;
+	case '*':
+		return TrailData::kUnvisitedFood;
+	case 'x':
+		return TrailData::kVisitedEmpty;
+	case 'X':
+		return TrailData::kVisitedFood;
+	}
+	return TrailData::kUnvisitedEmpty;
+}
+void MapDefinition::SetCell(size_t row, size_t column, TrailData data) {
+	if (row < row_count_ && column < column_count_) {
+		size_t index = GetCellIndex(row, column);
+		switch (data) {
+		case TrailData::kUnvisitedEmpty:
+			AssignBit(food_, index, false);
+			AssignBit(visited_, index, false);
+			break;
+		case TrailData::kUnvisitedFood:
+			AssignBit(food_, index, true);
+			AssignBit(visited_, index, false);
+			break;
+		case TrailData::kVisitedEmpty:
+			AssignBit(food_, index, false);
+			AssignBit(visited_, index, true);
+			break;
+		case TrailData::kVisitedFood:
+			AssignBit(food_, index, true);
+			AssignBit(visited_, index, true);
+			break;
+		}
+	}
+}
+void MapDefinition::SetTotalFoodCount() {
+	std::vector<uint64_t> eaten(food_.size());
+	for (size_t i = 0; i < food_.size(); ++i) {
+		eaten[i] = food_[i] & visited_[i];
+	}
+	total_food_ = PopCount(food_);
+	initial_consumed_food_ = PopCount(eaten);
+}
+void MapDefinition::SetHash() {
+	hash_ = HashCombine(0, row_count_);
+	hash_ = HashCombine(hash_, column_count_);
+	hash_ = HashCombine(hash_, action_count_limit_);
+	for (size_t i = 0; i < food_.size(); ++i) {
+		hash_ = HashCombine(hash_, food_[i]);
+		hash_ = HashCombine(hash_, visited_[i]);
+	}
+}
+bool MapDefinition::TestBit(const std::vector<uint64_t> &board,
+							size_t index) {
+	return (board[index >> 6] >> (index & 63)) & 1;
+}
+void MapDefinition::AssignBit(std::vector<uint64_t> &board, size_t index,
+							  bool value) {
+	uint64_t mask = uint64_t(1) << (index & 63);
+	if (value) {
+		board[index >> 6] |= mask;
+	} else {
+		board[index >> 6] &= ~mask;
+	}
+}
+size_t MapDefinition::PopCount(const std::vector<uint64_t> &board) {
+	size_t count = 0;
+	for (uint64_t word : board) {
+		count += std::bitset<64>(word).count();
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+/*
+ * map_definition.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Representation of the map that an Ant will attempt to traverse.
+ *
+ * @file
+ * @date 25 November 2015
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+/**
+ * @enum	TrailData
+ * Represents the possible values in a map cell.
+ */
+enum class TrailData {
+	kUnvisitedEmpty,	/**< An empty cell that hasn't been visited. */
+	kUnvisitedFood,		/**< A cell with uneaten food. */
+	kVisitedEmpty,		/**< An empty cell that's been visited. */
+	kVisitedFood		/**< A cell with food that's been eaten. */
+};
+/**
+ * @class	MapDefinition
+ * The immutable definition of a map that an Ant will traverse: its size,
+ * where the food is and the number of actions the ant may take.  Nothing in
+ * this class changes after construction, so a single definition can be
+ * shared by every population and every concurrent evaluation.  The mutable
+ * state of a single run lives in an `EvaluationContext`.
+ *
+ * The map is stored as two bitboards with one bit per cell in row-major
+ * order.  The food bitboard marks every cell that holds food, eaten or not,
+ * and the visited bitboard marks the cells that were already visited in the
+ * map file.
+ */
+class MapDefinition {
+public:
+	/**
+	 * Constructor requires a vector of strings.  This data gets parsed
+	 * and converted into `TrailData` items in the map.  Any rows that are
+	 * uneven have blank unvisited cells appended to the end of them to make
+	 * the map width uniform.
+	 *
+	 * @param[in]	map_file		A vector where each index is a string
+	 *								representing the line that was in the
+	 *								map data file.
+	 * @param[in]	step_limit		The maximum number of actions the Ant can
+	 *								make in a single evaluation run.
+	 */
+	MapDefinition(std::vector<std::string> map_file, size_t step_limit);
+	/** Retrieve the value at a given point.  Wraps around bounds. */
+	TrailData GetCell(size_t row, size_t column) const;
+	/** Return the bit index of a cell, wrapping around the bounds. */
+	size_t GetCellIndex(size_t row, size_t column) const;
+	/** Returns whether a cell holds food the ant hasn't eaten yet. */
+	bool HasUneatenFood(size_t index) const;
+	/** Returns whether a cell holds food, eaten or not. */
+	bool HasFood(size_t index) const;
+	/** Returns whether a cell was visited in the map file. */
+	bool IsVisited(size_t index) const;
+	/** Return the total number of food on the map. */
+	size_t GetTotalFoodCount() const;
+	/** Return the number of food already eaten in the map file. */
+	size_t GetInitialConsumedFoodCount() const;
+	/** Return the number of rows in the map. */
+	size_t GetRowCount() const;
+	/** Return the number of columns in the map. */
+	size_t GetColumnCount() const;
+	/** Return the maximum number of actions the ant can take. */
+	size_t GetActionLimit() const;
+	/**
+	 * Return a hash of the map's size, contents and action limit.  Two
+	 * definitions with the same hash give every ant the same score.
+	 */
+	uint64_t GetHash() const;
+	/** Return the number of bytes held for the contents of the map. */
+	size_t GetReservedBytes() const;
+	/**
+	 * Looks up what character represents a given `TrailData` item.  If an
+	 * invalid `TrailData` parameter is passed, the default is to return '?'.
+	 *
+	 * @param[in]	d	`TrailData` to match.
+	 *
+	 * @return `char` representing the input.
+	 */
+	static char ConvertTrailDataToChar(TrailData d);
+
+private:
+	/**
+	 * Looks up what `TrailData` is represented by a certain character.  If
+	 * an invalid character is passed, the default is to return
+	 * `TrailData::kUnvisitedEmpty`.
+	 *
+	 * @param[in]	c	Character to match.
+	 *
+	 * @return `TrailData` represented by the input.
+	 */
+	TrailData ConvertCharToTrailData(char c);
+	/** Explicitly set a cell's contents while parsing. Checks bounds. */
+	void SetCell(size_t row, size_t column, TrailData data);
+	/**
+	 * Determine the total number of food in a given map.  This will only need
+	 * to be called once at the creation of the `MapDefinition` object because
+	 * the food count is fixed.
+	 */
+	void SetTotalFoodCount();
+	/** Compute `hash_` once the map has been parsed. */
+	void SetHash();
+	/** Test whether a bit is set in a bitboard. */
+	static bool TestBit(const std::vector<uint64_t> &board, size_t index);
+	/** Set or clear a bit in a bitboard. */
+	static void AssignBit(std::vector<uint64_t> &board, size_t index,
+						  bool value);
+	/** Count the set bits in a bitboard. */
+	static size_t PopCount(const std::vector<uint64_t> &board);
+
+	std::vector<uint64_t> food_; /**< Cells with food, eaten or not. */
+	std::vector<uint64_t> visited_; /**< Cells visited in the map file. */
+	size_t action_count_limit_;
+	size_t total_food_;
+	size_t initial_consumed_food_;
+	size_t row_count_;
+	size_t column_count_;
+	uint64_t hash_;
+};
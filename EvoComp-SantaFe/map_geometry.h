@@ -0,0 +1,128 @@
+/*
+ * map_geometry.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Wraparound arithmetic for the toroidal maps.  The geometry is a template
+ * parameter of `BasicEvaluationContext` so the common map sizes can be
+ * resolved at compile time.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include "map_definition.h"
+
+/**
+ * @class	RuntimeGeometry
+ * Geometry of a map whose size is only known once the map file is read.
+ * Stepping off an edge uses a comparison rather than a modulus, which is
+ * correct for any map size.
+ */
+class RuntimeGeometry {
+public:
+	/** Take the size of the map from its definition. */
+	explicit RuntimeGeometry(const MapDefinition *map) :
+		row_count_(map->GetRowCount()),
+		column_count_(map->GetColumnCount()) {}
+	/** Return the row above `row`, wrapping to the bottom. */
+	size_t North(size_t row) const {
+		return (row == 0) ? row_count_ - 1 : row - 1;
+	}
+	/** Return the row below `row`, wrapping to the top. */
+	size_t South(size_t row) const {
+		return (row + 1 == row_count_) ? 0 : row + 1;
+	}
+	/** Return the column right of `column`, wrapping to the left edge. */
+	size_t East(size_t column) const {
+		return (column + 1 == column_count_) ? 0 : column + 1;
+	}
+	/** Return the column left of `column`, wrapping to the right edge. */
+	size_t West(size_t column) const {
+		return (column == 0) ? column_count_ - 1 : column - 1;
+	}
+	/** Return the row-major index of an in-bounds cell. */
+	size_t GetCellIndex(size_t row, size_t column) const {
+		return row * column_count_ + column;
+	}
+	/** Returns true if a map has the size this geometry handles. */
+	static bool Matches(const MapDefinition * /* map */) {
+		return true;
+	}
+private:
+	size_t row_count_;
+	size_t column_count_;
+};
+/**
+ * @class	FixedGeometry
+ * Geometry of a map whose size is fixed at compile time.  When a dimension
+ * is a power of two the wraparound is a single mask and the cell index is a
+ * shift, so the compiler folds the geometry away completely.  Other sizes
+ * fall back to the same comparisons as `RuntimeGeometry`, with constant
+ * bounds.
+ */
+template <size_t kRows, size_t kColumns>
+class FixedGeometry {
+public:
+	static_assert(kRows > 0 && kColumns > 0, "Maps cannot be empty");
+	/** The map is only used to match the `RuntimeGeometry` interface. */
+	explicit FixedGeometry(const MapDefinition * /* map */) {}
+	/** Return the row above `row`, wrapping to the bottom. */
+	size_t North(size_t row) const {
+		if (IsPowerOfTwo(kRows)) {
+			return (row - 1) & (kRows - 1);
+		}
+		return (row == 0) ? kRows - 1 : row - 1;
+	}
+	/** Return the row below `row`, wrapping to the top. */
+	size_t South(size_t row) const {
+		if (IsPowerOfTwo(kRows)) {
+			return (row + 1) & (kRows - 1);
+		}
+		return (row + 1 == kRows) ? 0 : row + 1;
+	}
+	/** Return the column right of `column`, wrapping to the left edge. */
+	size_t East(size_t column) const {
+		if (IsPowerOfTwo(kColumns)) {
+			return (column + 1) & (kColumns - 1);
+		}
+		return (column + 1 == kColumns) ? 0 : column + 1;
+	}
+	/** Return the column left of `column`, wrapping to the right edge. */
+	size_t West(size_t column) const {
+		if (IsPowerOfTwo(kColumns)) {
+			return (column - 1) & (kColumns - 1);
+		}
+		return (column == 0) ? kColumns - 1 : column - 1;
+	}
+	/** Return the row-major index of an in-bounds cell. */
+	size_t GetCellIndex(size_t row, size_t column) const {
+		return row * kColumns + column;
+	}
+	/** Returns true if a map has the size this geometry handles. */
+	static bool Matches(const MapDefinition *map) {
+		return map->GetRowCount() == kRows &&
+			   map->GetColumnCount() == kColumns;
+	}
+private:
+	static constexpr bool IsPowerOfTwo(size_t n) {
+		return (n & (n - 1)) == 0;
+	}
+};
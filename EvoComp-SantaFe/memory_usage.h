@@ -0,0 +1,57 @@
+/*
+ * memory_usage.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "node_arena.h"
+
+/**
+ * @struct	MemoryUsage
+ * Where the memory of a population goes, as reported by
+ * `Population::GetMemoryUsage()`.  Byte counts include storage that is held
+ * for reuse but not currently used.  Allocation and free counts are of
+ * `Node` slots during the last generation, by `NodeArena::Phase`.
+ */
+struct MemoryUsage {
+	size_t live_nodes = 0; /**< Node slots in use, both generations. */
+	size_t node_bytes = 0; /**< Bytes of the node slots in use. */
+	size_t arena_bytes = 0; /**< Bytes of chunks held by the arenas. */
+	size_t subtree_count = 0; /**< Entries of the `SubtreeTable`. */
+	size_t subtree_bytes = 0; /**< Bytes held by the `SubtreeTable`. */
+	size_t genome_bytes = 0; /**< Bytes held by `LinearGenome`s. */
+	size_t score_bytes = 0; /**< Bytes held by the individuals' scores. */
+	size_t program_bytes = 0; /**< Bytes held by compiled programs. */
+	size_t map_bytes = 0; /**< Bytes held by the map definitions. */
+	uint64_t allocations[NodeArena::kPhaseCount] = {};
+	uint64_t frees[NodeArena::kPhaseCount] = {};
+	uint64_t released = 0; /**< Slots freed by arena releases. */
+	size_t resident_bytes = 0; /**< Resident set size of the process. */
+};
+
+/**
+ * Return the resident set size of the process from `/proc/self/status`, or
+ * zero where it can't be read.
+ */
+size_t GetResidentBytes();
@@ -0,0 +1,188 @@
+/*
+ * migration_socket.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "migration_socket.h"
+/* Only the process islands of island_processes.cpp use the socket. */
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring> /* std::strerror, std::memcpy */
+#include <iostream> /* Logging/error reporting only */
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+MigrationSocket::MigrationSocket() : fd_(-1) {
+}
+MigrationSocket::~MigrationSocket() {
+	Close();
+}
+bool MigrationSocket::Listen(const std::string &path) {
+	sockaddr_un address;
+	if (!SetAddress(path, &address)) {
+		return false;
+	}
+	Close();
+	fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path.c_str());
+	if (fd_ < 0 ||
+		bind(fd_, reinterpret_cast<sockaddr*>(&address),
+			 sizeof(address)) != 0 ||
+		listen(fd_, SOMAXCONN) != 0) {
+		std::cerr << "Could not listen on " << path << ": ";
+		std::cerr << std::strerror(errno) << std::endl;
+		Close();
+		return false;
+	}
+	path_ = path;
+	return true;
+}
+bool MigrationSocket::Accept(MigrationSocket &listener) {
+	Close();
+	do {
+		fd_ = accept(listener.fd_, nullptr, nullptr);
+	} while (fd_ < 0 && errno == EINTR);
+	if (fd_ < 0) {
+		std::cerr << "Could not accept a connection: ";
+		std::cerr << std::strerror(errno) << std::endl;
+		return false;
+	}
+	return true;
+}
+bool MigrationSocket::Connect(const std::string &path) {
+	sockaddr_un address;
+	if (!SetAddress(path, &address)) {
+		return false;
+	}
+	Close();
+	fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd_ < 0 ||
+		connect(fd_, reinterpret_cast<sockaddr*>(&address),
+				sizeof(address)) != 0) {
+		std::cerr << "Could not connect to " << path << ": ";
+		std::cerr << std::strerror(errno) << std::endl;
+		Close();
+		return false;
+	}
+	return true;
+}
+bool MigrationSocket::Send(MessageType type, const std::string &payload) {
+	char header[kHeaderSize];
+	uint32_t size = static_cast<uint32_t>(payload.size());
+	header[0] = static_cast<char>(type);
+	for (size_t i = 0; i < 4; ++i) {
+		header[1 + i] = static_cast<char>(size >> (8 * i));
+	}
+	return WriteAll(header, kHeaderSize) &&
+		   WriteAll(payload.data(), payload.size());
+}
+bool MigrationSocket::Receive(MessageType type, std::string &payload) {
+	MessageType received;
+	if (!ReceiveAny(received, payload)) {
+		return false;
+	}
+	if (received != type) {
+		std::cerr << "Unexpected message of type ";
+		std::cerr << static_cast<int>(received) << std::endl;
+		return false;
+	}
+	return true;
+}
+bool MigrationSocket::IsReady(int timeout) {
+	pollfd descriptor;
+	descriptor.fd = fd_;
+	descriptor.events = POLLIN;
+	descriptor.revents = 0;
+	return poll(&descriptor, 1, timeout) > 0;
+}
+void MigrationSocket::Close() {
+	if (fd_ >= 0) {
+		close(fd_);
+		fd_ = -1;
+	}
+	if (!path_.empty()) {
+		unlink(path_.c_str());
+		path_.clear();
+	}
+}
+bool MigrationSocket::ReceiveAny(MessageType &type, std::string &payload) {
+	char header[kHeaderSize];
+	if (!ReadAll(header, kHeaderSize)) {
+		return false;
+	}
+	uint32_t size = 0;
+	for (size_t i = 0; i < 4; ++i) {
+		size |= static_cast<uint32_t>(static_cast<uint8_t>(header[1 + i]))
+				<< (8 * i);
+	}
+	type = static_cast<MessageType>(header[0]);
+	payload.resize(size);
+	return ReadAll(&payload[0], size);
+}
+bool MigrationSocket::SetAddress(const std::string &path, void *address) {
+	sockaddr_un *unix_address = static_cast<sockaddr_un*>(address);
+	std::memset(unix_address, 0, sizeof(*unix_address));
+	unix_address->sun_family = AF_UNIX;
+	if (path.size() >= sizeof(unix_address->sun_path)) {
+		std::cerr << "Socket path is too long: " << path << std::endl;
+		return false;
+	}
+	std::memcpy(unix_address->sun_path, path.c_str(), path.size() + 1);
+	return true;
+}
+bool MigrationSocket::WriteAll(const char *data, size_t size) {
+	while (size > 0) {
+		/* A closed peer is reported here rather than by SIGPIPE. */
+		ssize_t written = send(fd_, data, size, MSG_NOSIGNAL);
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			std::cerr << "Could not send a message: ";
+			std::cerr << std::strerror(errno) << std::endl;
+			return false;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+	return true;
+}
+bool MigrationSocket::ReadAll(char *data, size_t size) {
+	while (size > 0) {
+		ssize_t count = recv(fd_, data, size, 0);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count == 0) {
+			std::cerr << "Connection closed before a message ended";
+			std::cerr << std::endl;
+			return false;
+		}
+		if (count < 0) {
+			std::cerr << "Could not receive a message: ";
+			std::cerr << std::strerror(errno) << std::endl;
+			return false;
+		}
+		data += count;
+		size -= static_cast<size_t>(count);
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,100 @@
+/*
+ * migration_socket.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @class	MigrationSocket
+ * One end of a local stream socket that the coordinator and the worker
+ * processes of an island model talk over.  Each message is a type byte
+ * and a four-byte little-endian length followed by that many bytes of
+ * payload.  Every call blocks until it is done, and a failed call reports
+ * why on `std::cerr`, so a caller only has to stop.  It is a Unix domain
+ * socket, so it is only built on Linux, like the process islands.
+ */
+class MigrationSocket {
+public:
+	/** What a message holds, which is the first byte sent. */
+	enum class MessageType : uint8_t {
+		kHello, /**< The island of a worker, or the run seed in reply. */
+		kStatistics, /**< The statistics of a worker's last generation. */
+		kMigrants /**< Individuals encoded by `Individual::Encode()`. */
+	};
+
+	/** Create a socket that isn't open. */
+	MigrationSocket();
+	/** Close the socket, removing the path a listening socket is bound to. */
+	~MigrationSocket();
+	MigrationSocket(const MigrationSocket&) = delete;
+	MigrationSocket& operator=(const MigrationSocket&) = delete;
+	/**
+	 * Listen for connections at `path`, replacing any socket left there.
+	 *
+	 * @return	False if the socket couldn't be bound.
+	 */
+	bool Listen(const std::string &path);
+	/**
+	 * Wait for a connection to the listening socket `listener` and make
+	 * this socket the connection.
+	 */
+	bool Accept(MigrationSocket &listener);
+	/** Connect to a socket listening at `path`. */
+	bool Connect(const std::string &path);
+	/** Send one message. */
+	bool Send(MessageType type, const std::string &payload);
+	/**
+	 * Wait for one message, which has to be of type `type`.  It is an error
+	 * for the other end to close the socket first.
+	 *
+	 * @return	False if none came or it had another type.
+	 */
+	bool Receive(MessageType type, std::string &payload);
+	/**
+	 * Wait up to `timeout` milliseconds for a connection to a listening
+	 * socket, or a message to a connected one.
+	 *
+	 * @return	Whether one is waiting.
+	 */
+	bool IsReady(int timeout);
+	/** Close the socket. */
+	void Close();
+
+private:
+	/** Length of the header in front of each payload. */
+	static const size_t kHeaderSize = 5;
+
+	/** Fill the socket address for `path`, if it fits. */
+	bool SetAddress(const std::string &path, void *address);
+	/** Wait for one message of any type. */
+	bool ReceiveAny(MessageType &type, std::string &payload);
+	/** Write all of `size` bytes. */
+	bool WriteAll(const char *data, size_t size);
+	/** Read exactly `size` bytes. */
+	bool ReadAll(char *data, size_t size);
+
+	int fd_; /**< The file descriptor, or -1 if closed. */
+	std::string path_; /**< Path to remove on closing, if listening. */
+};
@@ -21,48 +21,61 @@
 #include <deque>
 #include <iostream> /* Logging/error reporting only */
 #include <string> /* for std::to_string() which may not be needed. */
+#include <new> /* placement new */
 #include <sstream>
 #include "node.h"
+#include "hash.h"
 
+static_assert(sizeof(Node) == NodeArena::kSlotSize,
+			  "A node has to fill exactly one arena slot");
+
+Node* Node::Create() {
+	uint32_t index = NodeArena::GetCurrent()->Allocate();
+	Node *node = new (NodeArena::GetSlot(index)) Node;
+	node->first_child_ = NodeArena::kNullIndex;
+	node->next_sibling_ = NodeArena::kNullIndex;
+	node->index_ = index;
+	node->terminal_count_ = 1;
+	node->nonterminal_count_ = 0;
+	node->height_ = 0;
+	node->op_ = OpType::kMoveForward;
+	node->hash_ = HashCombine(0, static_cast<uint64_t>(node->op_));
+	return node;
+}
 void Node::Copy(Node *to_copy) {
-	parent_ = to_copy->parent_;
 	op_ = to_copy->op_;
 
-	children_.clear();
-
-	switch (op_) {
-	case OpType::kProg3:
-	case OpType::kProg2:
-	case OpType::kIfFoodAhead:
-		children_.resize(to_copy->children_.size());
-		for (size_t i = 0; i < to_copy->children_.size(); ++i) {
-			children_[i] = new Node;
-			children_[i]->Copy(to_copy->children_[i]);
-		}
-		break;
+	first_child_ = NodeArena::kNullIndex;
+	uint32_t *link = &first_child_;
+	for (Node *child = to_copy->GetChild(0); child;
+		 child = child->GetNextSibling()) {
+		Node *copy = Create();
+		*link = copy->index_;
+		link = &copy->next_sibling_;
+		copy->Copy(child);
 	}
+	terminal_count_ = to_copy->terminal_count_;
+	nonterminal_count_ = to_copy->nonterminal_count_;
+	height_ = to_copy->height_;
+	hash_ = to_copy->hash_;
 }
 void Node::Erase() {
-	for (Node *child : children_) {
-		if (child) {
-			child->Erase();
-		}
-	}
-	delete this;
+	EraseChildren();
+	Free();
 }
 std::string Node::ToString(bool latex) {
 	/** @todo	Come up with a better representation of the solution. */
 	switch (op_) {
 	case OpType::kProg3:
-		return("(" + children_[0]->ToString(latex) + ") " +
-			   "(" + children_[1]->ToString(latex) + ") " +
-			   "(" + children_[2]->ToString(latex) + ")");
+		return("(" + GetChild(0)->ToString(latex) + ") " +
+			   "(" + GetChild(1)->ToString(latex) + ") " +
+			   "(" + GetChild(2)->ToString(latex) + ")");
 	case OpType::kProg2:
-		return("(" + children_[0]->ToString(latex) + ") " +
-			   "(" + children_[1]->ToString(latex) + ")");
+		return("(" + GetChild(0)->ToString(latex) + ") " +
+			   "(" + GetChild(1)->ToString(latex) + ")");
 	case OpType::kIfFoodAhead:
-		return("{" + children_[0]->ToString(latex) + "} " +
-			   "{" + children_[1]->ToString(latex) + "}");
+		return("{" + GetChild(0)->ToString(latex) + "} " +
+			   "{" + GetChild(1)->ToString(latex) + "}");
 	case OpType::kMoveForward:
 		return "^";
 	case OpType::kTurnLeft:
@@ -73,10 +86,9 @@ std::string Node::ToString(bool latex) {
 		return "!";
 	}
 }
-void Node::GenerateTree(size_t cur_depth, size_t max_depth,
-						Node *parent, bool full_tree) {
+void Node::GenerateTree(size_t cur_depth, size_t max_depth, bool full_tree,
+						Rng &rng) {
 	OpType lower_bound, upper_bound;
-	parent_ = parent;
 
 	if (full_tree) {
 		lower_bound = OpType::kProg3;
@@ -90,21 +102,22 @@ void Node::GenerateTree(size_t cur_depth, size_t max_depth,
 		upper_bound = OpType::kTurnRight;
 	}
 
-	std::uniform_int_distribution<int> d{ lower_bound, upper_bound };
-	op_ = static_cast<OpType>(d(GetEngine()));
+	op_ = static_cast<OpType>(lower_bound +
+							  rng.NextBounded(upper_bound - lower_bound + 1));
 	size_t children_counter = 0;
-	children_.clear(); /** @todo	Will this damage crossover? */
+	EraseChildren();
 	switch (op_) {
 	case OpType::kProg3:
 		++children_counter;
 	case OpType::kProg2:
 	case OpType::kIfFoodAhead:
 		children_counter += 2;
-		children_.resize(children_counter);
-		for (size_t i = 0; i < children_counter; ++i) {
-			Node *child = new Node;
-			children_[i] = child;
-			child->GenerateTree(cur_depth + 1, max_depth, this, full_tree);
+		for (uint32_t *link = &first_child_; children_counter > 0;
+			 --children_counter) {
+			Node *child = Create();
+			*link = child->index_;
+			link = &child->next_sibling_;
+			child->GenerateTree(cur_depth + 1, max_depth, full_tree, rng);
 		}
 		break;
 	case OpType::kMoveForward:
@@ -117,12 +130,21 @@ void Node::GenerateTree(size_t cur_depth, size_t max_depth,
 		exit(EXIT_FAILURE);
 		break;
 	}
+	UpdateCounts();
 }
-void Node::Mutate(double mutation_chance, size_t max_depth) {
-	std::uniform_real_distribution<double> mut_dist{ 0,1 };
+bool Node::Mutate(double mutation_chance,
+				  const std::vector<uint8_t> &mutations, size_t &next_mutation,
+				  size_t cur_depth, size_t max_depth, Rng &rng) {
 	const size_t kMinimumTreeIncrease = 3;
+	bool mutate;
+	if (next_mutation < mutations.size()) {
+		mutate = mutations[next_mutation] != 0;
+	} else {
+		mutate = rng.NextBernoulli(mutation_chance);
+	}
+	++next_mutation;
 
-	if (mut_dist(GetEngine()) <= mutation_chance) {
+	if (mutate) {
 		OpType lower_bound, upper_bound;
 		if (IsTerminal()) {
 			lower_bound = OpType::kMoveForward;
@@ -131,49 +153,61 @@ void Node::Mutate(double mutation_chance, size_t max_depth) {
 			lower_bound = OpType::kProg3;
 			upper_bound = OpType::kIfFoodAhead;
 		}
-		std::uniform_int_distribution<int> d{ lower_bound, upper_bound };
-		op_ = static_cast<OpType>(d(GetEngine()));
+		op_ = static_cast<OpType>(lower_bound + rng.NextBounded(
+			upper_bound - lower_bound + 1));
 		size_t children_counter = 0;
-		children_.clear();
+		EraseChildren();
 		switch (op_) {
 		case OpType::kProg3:
 			++children_counter;
 		case OpType::kProg2:
 		case OpType::kIfFoodAhead:
 			children_counter += 2;
-			children_.resize(children_counter);
-			for (size_t i = 0; i < children_counter; ++i) {
-				Node *child = new Node;
-				children_[i] = child;
+			for (uint32_t *link = &first_child_; children_counter > 0;
+				 --children_counter) {
+				Node *child = Create();
+				*link = child->index_;
+				link = &child->next_sibling_;
 				/* Determine max tree size */
 				size_t adjusted_depth = max_depth;
-				if (adjusted_depth < depth_) {
-					adjusted_depth = depth_ + kMinimumTreeIncrease;
+				if (adjusted_depth < cur_depth) {
+					adjusted_depth = cur_depth + kMinimumTreeIncrease;
 				}
-				child->GenerateTree(depth_ + 1, adjusted_depth, this, false);
+				child->GenerateTree(cur_depth + 1, adjusted_depth, false, rng);
 			}
 		}
-	} else {
-		for (Node *child : children_) {
-			child->Mutate(mutation_chance, max_depth);
+		UpdateCounts();
+		return true;
+	}
+	bool mutated = false;
+	for (Node *child = GetChild(0); child; child = child->GetNextSibling()) {
+		if (child->Mutate(mutation_chance, mutations, next_mutation,
+						  cur_depth + 1, max_depth, rng)) {
+			mutated = true;
 		}
 	}
+	if (mutated) {
+		UpdateCounts();
+	}
+	return mutated;
 }
-void Node::Evaluate(TrailMap *map) {
+bool Node::Evaluate(EvaluationContext *map) {
 	switch (op_) {
 	case OpType::kProg3:
 	case OpType::kProg2:
-		for (Node *child : children_) {
-			child->Evaluate(map);
+		for (Node *child = GetChild(0); child;
+			 child = child->GetNextSibling()) {
+			if (!child->Evaluate(map)) {
+				return false;
+			}
 		}
-		break;
+		return true;
 	case OpType::kIfFoodAhead:
 		if (map->IsFoodAhead()) {
-			children_[0]->Evaluate(map);
+			return GetChild(0)->Evaluate(map);
 		} else {
-			children_[1]->Evaluate(map);
+			return GetChild(1)->Evaluate(map);
 		}
-		break;
 	case OpType::kMoveForward:
 		map->MoveForward();
 		break;
@@ -184,56 +218,124 @@ void Node::Evaluate(TrailMap *map) {
 		map->TurnRight();
 		break;
 	}
+	return map->HasActionsRemaining() && !map->IsTrailCleared();
 }
-std::pair<Node*, size_t> Node::SelectNode(size_t countdown, bool nonterminal) {
-	std::deque<std::pair<Node*, size_t>> stack;
-	std::pair<Node*, size_t> curr;
-	bool done = false;
-
-	stack.emplace_front(std::make_pair(this, 0));
+std::pair<Node*, size_t> Node::SelectNode(size_t countdown, bool nonterminal,
+										  std::vector<Node*> *ancestors) {
+	Node *node = this;
+	size_t child_number = 0;
 
-	while (!done) {
-		if (stack.empty()) {
-			std::cerr << "Empty stack!" << std::endl;
-			exit(EXIT_FAILURE);
+	if (ancestors) {
+		ancestors->clear();
+	}
+	while (true) {
+		bool matches = nonterminal == node->IsNonterminal();
+		if (matches) {
+			if (countdown == 0) {
+				/* Found the correct node */
+				break;
+			}
+			--countdown;
+		}
+		size_t remaining = nonterminal ? node->nonterminal_count_
+									   : node->terminal_count_;
+		if (matches) {
+			--remaining;
 		}
-		if (countdown == SIZE_MAX) {
-			std::cerr << "Countdown wrapped around!" << std::endl;
+		if (countdown >= remaining) {
+			std::cerr << "No node left to select!" << std::endl;
 			exit(EXIT_FAILURE);
 		}
-		curr = stack.front();
-		stack.pop_front();
-		if (countdown == 0 && nonterminal == curr.first->IsNonterminal()) {
-			/* Found the correct node */
-			done = true;
-			break;
+		/*
+		 * The last child is numbered first, so walking the children in order
+		 * the wanted node is `remaining - countdown` from the end.
+		 */
+		size_t from_end = remaining - countdown;
+		size_t passed = 0;
+		size_t i = 0;
+		Node *child = node->GetChild(0);
+		while (true) {
+			size_t count = nonterminal ? child->nonterminal_count_
+									   : child->terminal_count_;
+			if (passed + count >= from_end) {
+				countdown = passed + count - from_end;
+				break;
+			}
+			passed += count;
+			child = child->GetNextSibling();
+			++i;
 		}
-		if (nonterminal == curr.first->IsNonterminal()) {
-			--countdown;
+		if (ancestors) {
+			ancestors->push_back(node);
 		}
-		for (size_t i = 0; i < curr.first->children_.size(); ++i) {
-			stack.emplace_front(std::make_pair(curr.first->children_[i], i));
+		node = child;
+		child_number = i;
+	}
+	return std::make_pair(node, child_number);
+}
+uint64_t Node::Hash() {
+	return hash_;
+}
+bool Node::Equals(Node *other) {
+	if (op_ != other->op_) {
+		return false;
+	}
+	Node *child = GetChild(0);
+	Node *other_child = other->GetChild(0);
+	for (; child && other_child; child = child->GetNextSibling(),
+		 other_child = other_child->GetNextSibling()) {
+		if (!child->Equals(other_child)) {
+			return false;
 		}
 	}
-	return curr;
+	return !child && !other_child;
 }
-void Node::CountNodes(size_t &term_count, size_t &nonterm_count) {
+Node* Node::Simplify(FoodSense sense) {
+	Node *node;
+	Node *then_branch;
+	Node *else_branch;
+	std::vector<Node*> sequence;
+
 	switch (op_) {
+	case OpType::kIfFoodAhead:
+		/* Checking for food isn't an action, so the outcome is still known. */
+		if (sense == FoodSense::kFood) {
+			return GetChild(0)->Simplify(sense);
+		} else if (sense == FoodSense::kNoFood) {
+			return GetChild(1)->Simplify(sense);
+		}
+		then_branch = GetChild(0)->Simplify(FoodSense::kFood);
+		else_branch = GetChild(1)->Simplify(FoodSense::kNoFood);
+		if (then_branch->Equals(else_branch)) {
+			else_branch->Erase();
+			return then_branch;
+		}
+		node = Create();
+		node->op_ = op_;
+		node->SetChildren({ then_branch, else_branch });
+		return node;
 	case OpType::kProg3:
 	case OpType::kProg2:
-	case OpType::kIfFoodAhead:
-		++nonterm_count;
-		for (Node* child : children_) {
-			child->CountNodes(term_count, nonterm_count);
+		/* Only the first child runs before the ant takes an action. */
+		for (Node *child = GetChild(0); child;
+			 child = child->GetNextSibling()) {
+			FlattenSequence(child->Simplify((child == GetChild(0)) ?
+											sense : FoodSense::kUnknown),
+							sequence);
 		}
-		break;
-	case OpType::kMoveForward:
-	case OpType::kTurnLeft:
-	case OpType::kTurnRight:
-		++term_count;
-		break;
+		CollapseTurns(sequence);
+		return PackSequence(sequence, 0, sequence.size());
+	default:
+		node = Create();
+		node->op_ = op_;
+		node->hash_ = hash_;
+		return node;
 	}
 }
+void Node::CountNodes(size_t &term_count, size_t &nonterm_count) {
+	term_count += terminal_count_;
+	nonterm_count += nonterminal_count_;
+}
 bool Node::IsNonterminal() {
 	switch (op_) {
 	case OpType::kProg3:
@@ -246,43 +348,177 @@ bool Node::IsNonterminal() {
 bool Node::IsTerminal() {
 	return !IsNonterminal();
 }
-void Node::CorrectNodes(Node *parent, size_t depth) {
-	this->parent_ = parent;
-	this->depth_ = depth;
-	if (IsNonterminal()) {
-		for (Node *child : children_) {
-			child->CorrectNodes(this, depth + 1);
+bool Node::IsTurn() {
+	return op_ == OpType::kTurnLeft || op_ == OpType::kTurnRight;
+}
+void Node::UpdateCounts() {
+	terminal_count_ = IsNonterminal() ? 0 : 1;
+	nonterminal_count_ = IsNonterminal() ? 1 : 0;
+	height_ = 0;
+	hash_ = HashCombine(0, static_cast<uint64_t>(op_));
+	for (Node *child = GetChild(0); child; child = child->GetNextSibling()) {
+		terminal_count_ += child->terminal_count_;
+		nonterminal_count_ += child->nonterminal_count_;
+		hash_ = HashCombine(hash_, child->hash_);
+		if (child->height_ >= height_) {
+			height_ = child->height_ + 1;
 		}
 	}
 }
-Node* Node::GetParent() {
-	return parent_;
-}
 Node* Node::GetChild(size_t child_number) {
-	if (child_number < children_.size()) {
-		return children_[child_number];
+	uint32_t child = first_child_;
+	for (; child != NodeArena::kNullIndex && child_number > 0;
+		 --child_number) {
+		child = At(child)->next_sibling_;
 	}
-	return nullptr;
+	return (child != NodeArena::kNullIndex) ? At(child) : nullptr;
 }
-void Node::SetParent(Node *parent) {
-	parent_ = parent;
+Node* Node::GetNextSibling() {
+	return (next_sibling_ != NodeArena::kNullIndex) ? At(next_sibling_)
+													: nullptr;
 }
 void Node::SetChild(size_t child_number, Node *child) {
-	if (child_number < children_.size()) {
-		children_[child_number] = child;
+	uint32_t *link = &first_child_;
+	for (; *link != NodeArena::kNullIndex && child_number > 0;
+		 --child_number) {
+		link = &At(*link)->next_sibling_;
 	}
-	children_.push_back(child);
+	if (*link != NodeArena::kNullIndex) {
+		child->next_sibling_ = At(*link)->next_sibling_;
+		*link = child->index_;
+		/* The child is appended too, as a copy so it has only one parent. */
+		Node *copy = Create();
+		copy->Copy(child);
+		child = copy;
+	}
+
+	/* Append the child after the last one. */
+	while (*link != NodeArena::kNullIndex) {
+		link = &At(*link)->next_sibling_;
+	}
+	*link = child->index_;
+	child->next_sibling_ = NodeArena::kNullIndex;
+	UpdateCounts();
+}
+OpType Node::GetOperator() {
+	return op_;
+}
+size_t Node::GetHeight() {
+	return height_;
 }
-size_t Node::GetCurrentDepth() {
-	return depth_;
+void Node::Free() {
+	NodeArena::GetCurrent()->Free(index_);
+}
+void Node::EraseChildren() {
+	uint32_t child = first_child_;
+	while (child != NodeArena::kNullIndex) {
+		Node *node = At(child);
+		child = node->next_sibling_;
+		node->Erase();
+	}
+	first_child_ = NodeArena::kNullIndex;
+}
+void Node::SetChildren(std::initializer_list<Node*> children) {
+	uint32_t *link = &first_child_;
+	for (Node *child : children) {
+		*link = child->index_;
+		link = &child->next_sibling_;
+	}
+	*link = NodeArena::kNullIndex;
+	UpdateCounts();
 }
 std::string Node::CallGraphViz(std::string graph_name) {
 	return GraphViz(graph_name);
 }
-std::mt19937 &Node::GetEngine() {
-	static std::random_device rd;
-	static std::mt19937 mt(rd());
-	return mt;
+void Node::FlattenSequence(Node *node, std::vector<Node*> &sequence) {
+	if (node->op_ == OpType::kProg3 || node->op_ == OpType::kProg2) {
+		for (Node *child = node->GetChild(0); child;
+			 child = child->GetNextSibling()) {
+			FlattenSequence(child, sequence);
+		}
+		node->Free();
+	} else {
+		sequence.push_back(node);
+	}
+}
+void Node::CollapseTurns(std::vector<Node*> &sequence) {
+	std::vector<Node*> collapsed;
+	size_t i = 0;
+
+	while (i < sequence.size()) {
+		if (!sequence[i]->IsTurn()) {
+			collapsed.push_back(sequence[i++]);
+			continue;
+		}
+		/* Sum the run as quarter turns clockwise, reusing its first nodes. */
+		size_t first = i;
+		size_t rotation = 0;
+		for (; i < sequence.size() && sequence[i]->IsTurn(); ++i) {
+			rotation += (sequence[i]->op_ == OpType::kTurnRight) ? 1 : 3;
+		}
+		size_t kept = 0;
+		switch (rotation % 4) {
+		case 1:
+			sequence[first]->op_ = OpType::kTurnRight;
+			kept = 1;
+			break;
+		case 2:
+			sequence[first]->op_ = OpType::kTurnRight;
+			sequence[first + 1]->op_ = OpType::kTurnRight;
+			kept = 2;
+			break;
+		case 3:
+			sequence[first]->op_ = OpType::kTurnLeft;
+			kept = 1;
+			break;
+		}
+		if (kept == 0 && first == 0 && i == sequence.size()) {
+			sequence[0]->op_ = OpType::kTurnLeft;
+			sequence[1]->op_ = OpType::kTurnRight;
+			kept = 2;
+		}
+		for (size_t j = first; j < i; ++j) {
+			if (j < first + kept) {
+				/* The turn may have changed direction. */
+				sequence[j]->UpdateCounts();
+				collapsed.push_back(sequence[j]);
+			} else {
+				sequence[j]->Erase();
+			}
+		}
+	}
+	sequence = collapsed;
+}
+Node* Node::PackSequence(const std::vector<Node*> &sequence, size_t first,
+						 size_t last) {
+	size_t count = last - first;
+	Node *node;
+
+	if (count == 1) {
+		return sequence[first];
+	}
+	node = Create();
+	if (count == 2) {
+		node->op_ = OpType::kProg2;
+		node->SetChildren({ sequence[first], sequence[first + 1] });
+		return node;
+	}
+	/*
+	 * A sequence of odd length packs into kProg3 nodes alone if it is split
+	 * into three odd parts.  An even one needs a single kProg2, so two parts
+	 * are odd and the third is even.
+	 */
+	size_t part = (count + 2) / 3;
+	if (part % 2 == 0) {
+		--part;
+	}
+	node->op_ = OpType::kProg3;
+	node->SetChildren({
+		PackSequence(sequence, first, first + part),
+		PackSequence(sequence, first + part, first + 2 * part),
+		PackSequence(sequence, first + 2 * part, last)
+	});
+	return node;
 }
 Node::NodeWrapper* Node::ConstructGraphVizNode(Node *n, int counter) {
 
@@ -349,10 +585,13 @@ std::string Node::GraphViz(std::string graph_name) {
 			ss << "\n";
 		}
 
-		for (Node *child : curr.first->node->children_) {
+		Node *node = curr.first->node;
+		for (Node *child = node->GetChild(0); child;
+			 child = child->GetNextSibling()) {
 			++counter;
 			queue.emplace_front(std::make_pair(
-				ConstructGraphVizNode(child, counter), curr.first->node_name));
+				ConstructGraphVizNode(child, counter),
+				curr.first->node_name));
 		}
 	}
 	ss << "}";
@@ -23,31 +23,64 @@
  */
 #pragma once
 
-#include <random>
+#include <cstdint>
+#include <initializer_list>
 #include <utility> /* std::pair */
 #include <vector>
 #include "operator_types.h"
-#include "trail_map.h"
+#include "evaluation_context.h"
+#include "node_arena.h"
+#include "rng.h"
 
+/**
+ * @enum	FoodSense
+ * What is known about the cell ahead of the ant at a point in the tree.
+ * Used while simplifying, since the result of an `kIfFoodAhead` holds until
+ * the ant takes its next action.
+ */
+enum class FoodSense {
+	kUnknown,
+	kFood,
+	kNoFood
+};
 /** 
  * @class	Node
- * Node of a generic tree data structure.  This class uses the default 
- * constructor and destructor and instead of having a copy constructor, just 
- * has a `Copy()` and `Erase()` function instead.  The tree functions provided
- * are for the use of the Individual and Population classes.
+ * Node of a generic tree data structure.  Nodes are made by `Create()` in
+ * the current `NodeArena` and instead of having a copy constructor and
+ * destructor, there are `Copy()` and `Erase()` functions instead.  The tree
+ * functions provided are for the use of the Individual and Population
+ * classes.
+ *
+ * A node is kept to a single 32-byte arena slot: a one-byte operator,
+ * 32-bit slot indices of its first child, its next sibling and itself, the
+ * number of terminals and nonterminals in its subtree along with its
+ * height, and the structural hash of its subtree.  Children are linked as a list rather than held in an array,
+ * since crossover can give a node more children than its operator uses.
+ * Nodes don't know their parent or depth; `SelectNode()` finds the
+ * ancestors and the recursive functions pass the depth down.
+ *
+ * The subtree counts and hash of a node are kept up to date by the
+ * functions that build and change trees here.  Code that changes a subtree
+ * in place has to call `UpdateCounts()` on every ancestor of the change,
+ * deepest first, so a change only rehashes the path down to it.
  *
  * @todo	It would be nice to use actual constructors and destructors 
  *			instead of the `Copy()` and `Erase()` functions.
  */
 class Node {
 public:
+	/** Make a terminal node with no children in the current `NodeArena`. */
+	static Node* Create();
 	/** 
 	 * Creates a new version of a node, given a reference node.
 	 *
 	 * @todo	Determine whether I still need a pointer to the source node. 
 	 */
 	void Copy(Node *to_copy);
-	/** Recursively erase the current node and its subtree. */
+	/**
+	 * Recursively erase the current node and its subtree, returning their
+	 * memory to the current `NodeArena`.
+	 */
 	void Erase();
 	/** 
 	 * A text representation of a node and its subtree.
@@ -62,55 +95,110 @@ public:
 	 * @param[in]	cur_depth	The current depth of the tree.
 	 * @param[in]	max_depth	The maximum depth the tree can be before 
 	 * 							creating a terminal node.
-	 * @param[in]	parent		Pointer to the parent node that's used to set
-	 *							the parent parameter of the node.
 	 * @param[in]	full_tree	If set to true, a nonterminal node will not
 	 *							be created until the max depth has been
 	 *							reached.  This is used for ramped half and 
 	 *							half tree generation.
+	 * @param[in]	rng			The generator to draw operators from.
 	 */
-	void GenerateTree(size_t cur_depth, size_t max_depth, 
-					  Node *parent, bool full_tree);
+	void GenerateTree(size_t cur_depth, size_t max_depth, bool full_tree,
+					  Rng &rng);
 	/**
 	 * Recursively traverses the tree and randomly changes a node's operator 
 	 * to another of the same arity.
 	 *
-	 * @param[in]	mutation_chance		The possibility that an individual 
-	 *									node will mutate.
-	 * @param[in]	max_depth			Max tree depth to help curb code 
-	 *									growth.
+	 * @param[in]		mutation_chance		The possibility that an individual 
+	 *										node will mutate.
+	 * @param[in]		mutations			Whether each node visited mutates,
+	 *										drawn up front in visiting order.
+	 *										Once it runs out, each further
+	 *										node draws with `mutation_chance`.
+	 * @param[in,out]	next_mutation		Index of the next entry of
+	 *										`mutations` to use.
+	 * @param[in]		cur_depth			The depth of this node.
+	 * @param[in]		max_depth			Max tree depth to help curb code 
+	 *										growth.
+	 * @param[in]		rng					The generator to draw from.
+	 *
+	 * @return	True if any node of the subtree mutated.  Only the subtree
+	 *			counts of such nodes and their ancestors are recalculated.
 	 */
-	void Mutate(double mutation_chance, size_t max_depth);
+	bool Mutate(double mutation_chance, const std::vector<uint8_t> &mutations,
+				size_t &next_mutation, size_t cur_depth, size_t max_depth,
+				Rng &rng);
 	/**
 	 * Evaluate the fitness of a node and its subtree.
-	 * @param[in]	*map		A pointer to a map that's being evaluated.
-	 *							The Individual and the TrailMap will know to
-	 *							stop execution and the Map will contain the
-	 *							number of food eaten and path taken during
-	 *							execution.
-	 */
-	void Evaluate(TrailMap *map);
-	/**
-	 * Select a node from the tree.  Iteratively searches the tree,
-	 * decrementing the `countdown` number each time only when a node
-	 * desginated by the value of `nonterminal` is visited. Upon reaching 
-	 * zero, the current node is returned as well its index in the child tree.
+	 * @param[in]	*map		A pointer to the context of the map that's
+	 *							being evaluated.  The Individual and the
+	 *							context will know to stop execution and the
+	 *							context will contain the number of food eaten
+	 *							and path taken during execution.
+	 *
+	 * @return	False once the ant is out of actions or has cleared the
+	 *			trail, so the rest of the tree is skipped immediately.
+	 */
+	bool Evaluate(EvaluationContext *map);
+	/**
+	 * Select a node from the tree.  Nodes of the type designated by
+	 * `nonterminal` are numbered in preorder, visiting the children of a
+	 * node last to first, and the node numbered `countdown` is returned as
+	 * well as its index in the child tree.  The subtree counts lead straight
+	 * down to it, so only the children of its ancestors are looked at.
 	 * @param[in]	countdown	How many more nodes remain before selection.
 	 * @param[in]	nonterminal	Type of node to select.
+	 * @param[out]	ancestors	If not null, set to the ancestors of the
+	 *							selected node from this node down to its
+	 *							parent.  Empty if this node is selected.
 	 *
 	 * @return	Returns a pair consisting of the selected node as well as the
-	 *			index of the node in the node's parent's `children_` vector.
+	 *			index of the node among its parent's children.
 	 */
-	std::pair<Node*, size_t> SelectNode(size_t countdown, bool nonterminal);
+	std::pair<Node*, size_t> SelectNode(size_t countdown, bool nonterminal,
+										std::vector<Node*> *ancestors);
 	/** 
-	 * Recursively iterates through the tree and counts the number of nodes
-	 * encountered.
+	 * Adds the number of terminal and nonterminal nodes in the subtree to
+	 * the counts given.  The counts are stored, so this takes constant time.
 	 *
 	 * @param[out]	term_count		The number of terminal nodes in the tree.
 	 * @param[out]	nonterm_count	The number of nonterminal nodes in the 
 	 *								tree.
 	 */
 	void CountNodes(size_t &term_count, size_t &nonterm_count);
+	/**
+	 * Returns the hash of the structure of the node and its subtree.  Trees
+	 * with the same operators in the same shape have the same hash, no
+	 * matter where their nodes live in memory.  The hash is stored, so this
+	 * takes constant time.
+	 */
+	uint64_t Hash();
+	/**
+	 * Returns whether the subtree has exactly the same structure as another
+	 * subtree.
+	 */
+	bool Equals(Node *other);
+	/**
+	 * Build a simplified copy of the node and its subtree.  The copy makes
+	 * the ant follow exactly the same path over the map.  The rewrites are:
+	 * - an `kIfFoodAhead` whose outcome is already known, because it is the
+	 *   first thing run inside a branch of another `kIfFoodAhead`, is
+	 *   replaced by the branch that would be taken;
+	 * - an `kIfFoodAhead` with identical branches is replaced by the branch;
+	 * - nested `kProg2`/`kProg3` nodes are flattened into one sequence and
+	 *   repacked using as few nodes as possible;
+	 * - runs of consecutive turns are replaced by the fewest turns with the
+	 *   same net rotation, e.g. left-right disappears and four lefts become
+	 *   nothing.
+	 *
+	 * Dropping turns means the ant spends fewer actions getting to each cell
+	 * on its path, so under an action limit the copy eats at least as much
+	 * food as the original.
+	 *
+	 * @param[in]	sense	What is known about the cell ahead when the node
+	 *						starts running.
+	 *
+	 * @return	The root of the simplified copy.
+	 */
+	Node* Simplify(FoodSense sense);
 	/** 
 	 * Determines if the current node is terminal.  Checks the operator type
 	 * of the node to determine if terminal or not.
@@ -125,21 +213,15 @@ public:
 	 * @return	True if a nonterminal operator type.
 	 */
 	bool IsNonterminal();
-	/** 
-	 * Recursively iterate through the tree and set the parent point of each
-	 * node and the depth of the node.  This is useful after the crossover 
-	 * function has completed to make sure that the tree can be traversed in 
-	 * both directions and also allows trees to leave scope and have their 
-	 * memory freed.
-	 *
-	 * @param[in]	parent	Pointer to the parent.
-	 * @param[in]	depth	The current depth.
+	/** Returns true if the node turns the ant left or right. */
+	bool IsTurn();
+	/**
+	 * Recalculate the subtree counts, height and hash of the node from
+	 * those of its children, which have to be up to date.
 	 */
-	void CorrectNodes(Node *parent, size_t depth);
+	void UpdateCounts();
 
 	/* Accessors/Mutators of Private Data */
-	/** Returns the node's parent. */
-	Node* GetParent();
 	/** 
 	 * Returns the child node of the node based on the index number given.
 	 *
@@ -148,12 +230,23 @@ public:
 	 * @return	The child node at the given index and `nullptr` otherwise.
 	 */
 	Node* GetChild(size_t child_number);
-	/** Sets the `parent_` value of the node. */
-	void SetParent(Node *parent);
-	/** Sets the value of `children_` at the given index number. */
+	/**
+	 * Returns the next child of this node's parent, or `nullptr` if this is
+	 * the last one.
+	 */
+	Node* GetNextSibling();
+	/**
+	 * Sets the child at the given index number.  The child it replaces is
+	 * unlinked but not erased.  The child is also appended as an extra
+	 * child, which is how crossover has always grown trees; if it was
+	 * placed at the index as well, a copy is appended so that no node has
+	 * two parents.
+	 */
 	void SetChild(size_t child_number, Node *child);
-	/** Returns the depth of this node in the tree. */
-	size_t GetCurrentDepth();
+	/** Returns the operator type of the node. */
+	OpType GetOperator();
+	/** Returns the height of the subtree, zero for a single node. */
+	size_t GetHeight();
 	/** 
 	 * Public accessor to the `Node::GraphViz` method.  Used to prevent having
 	 * to potentially expose the underlying data structures used to create
@@ -166,6 +259,10 @@ public:
 	 */
 	std::string CallGraphViz(std::string graph_name);
 private:
+	/** Converts between trees and their prefix-order arrays. */
+	friend class LinearGenome;
+	friend class SharedTree;
+
 	/**
 	 * Just a simple structure to help make sure that `Node::GraphViz()` can
 	 * properly create the nodes of the digraph.
@@ -176,18 +273,40 @@ private:
 		std::string node_label; /*< Label representing the type of node. */
 		bool nonterminal; /*< Used to define the node shape/style. */
 	};
+	/** Return the node with the given arena slot index. */
+	static Node* At(uint32_t index) {
+		return static_cast<Node*>(NodeArena::GetSlot(index));
+	}
+	/** Return the node, but not its children, to the current `NodeArena`. */
+	void Free();
+	/** Erase the subtrees of the children and leave the node without any. */
+	void EraseChildren();
+	/**
+	 * Link `children` to the node in order, in place of any it had.  The
+	 * old children aren't erased.
+	 */
+	void SetChildren(std::initializer_list<Node*> children);
+	/**
+	 * Append a simplified subtree to a sequence of nodes to run in order,
+	 * splicing in the children of `kProg2`/`kProg3` nodes instead of the
+	 * nodes themselves.
+	 */
+	static void FlattenSequence(Node *node, std::vector<Node*> &sequence);
+	/**
+	 * Replace every run of consecutive turns in a sequence with the fewest
+	 * turns that have the same net rotation.  A sequence made up entirely of
+	 * turns that cancel out keeps two of them, since a tree can't be empty.
+	 */
+	static void CollapseTurns(std::vector<Node*> &sequence);
 	/**
-	 * A static random engine that can be shared throughout the entire class.
-	 * Based on the idea found in:
-	 * http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3551.pdf
-	 * This class uses the well-defined STL Mersenne Twister engine, mt19937.
-	 * The first time this method is called, a std::mt19937 engine is
-	 * initialized and seeded by `std::random_device` and is returned.  All
-	 * subsequent calls return the originally created engine.
+	 * Pack the nodes `sequence[first]` up to but not including
+	 * `sequence[last]` under as few `kProg3`/`kProg2` nodes as possible,
+	 * keeping the result shallow.
 	 *
-	 * @return	A Mersenne Twister Engine seeded by `std::random_device`.
+	 * @return	The root of the packed sequence.
 	 */
-	std::mt19937 &GetEngine();
+	static Node* PackSequence(const std::vector<Node*> &sequence,
+							  size_t first, size_t last);
 
 	/** 
 	 * Create a NodeWrapper* object based on the root of the subtree and a
@@ -204,7 +323,7 @@ private:
 	NodeWrapper* ConstructGraphVizNode(Node *root, int counter);
 	/** 
 	 * Creates a GraphViz file that can read by `dot` to create a visual
-	 * representation of the execution tree that the `TrailMap::Ant` will
+	 * representation of the execution tree that the `Ant` will
 	 * follow.
 	 *
 	 * @param[in]	graph_name	The name of the digraph.
@@ -214,23 +333,24 @@ private:
 	 */
 	std::string GraphViz(std::string graph_name);
 
-	/** A pointer to the parent node or `nullptr` if the root of the tree */
-	Node *parent_;
-	/** Pointers to children nodes. */
-	std::vector<Node*> children_;
+	/** Structural hash of the subtree, as `Hash()` returns. */
+	uint64_t hash_;
+	/** Slot of the first child, or `NodeArena::kNullIndex` if none. */
+	uint32_t first_child_;
+	/** Slot of the next child of the same parent, if there is one. */
+	uint32_t next_sibling_;
+	/** Slot of this node, which is what its parent links to. */
+	uint32_t index_;
+	/** Number of terminal nodes in the subtree, including this node. */
+	uint32_t terminal_count_;
+	/** Number of nonterminal nodes in the subtree, including this node. */
+	uint32_t nonterminal_count_;
+	/** Number of edges on the longest path down to a leaf. */
+	uint16_t height_;
 	/**
 	 * The operator type of the node.  This is used to determine whether the
 	 * node is terminal or nonterminal and for determining how to traverse
-	 * the subtree.  The depth is simply how far into the tree we are.  This
-	 * is used to help curb code growth.
+	 * the subtree.
 	 */
 	OpType op_;
-	/**
-	 * The current depth of the node.  Used when creating new subtrees during
-	 * the crossover/mutation operation.
-	 */
-	size_t depth_;
-
-	
-
 };
\ No newline at end of file
@@ -0,0 +1,110 @@
+/*
+ * node_arena.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "node_arena.h"
+#include <cstdlib> /* exit, EXIT_FAILURE */
+#include <cstring> /* std::memcpy */
+#include <iostream> /* Logging/error reporting only */
+
+thread_local NodeArena *NodeArena::current_ = nullptr;
+thread_local NodeArena::Phase NodeArena::phase_ = NodeArena::Phase::kInit;
+char *NodeArena::chunk_table_[NodeArena::kMaxChunks];
+std::vector<uint32_t> NodeArena::unused_chunks_;
+uint32_t NodeArena::chunk_count_ = 1;
+std::mutex NodeArena::chunk_table_mutex_;
+
+NodeArena::Scope::Scope(NodeArena *arena) : previous_(current_) {
+	current_ = arena;
+}
+NodeArena::Scope::~Scope() {
+	current_ = previous_;
+}
+NodeArena::NodeArena() : next_chunk_(0), next_(kNullIndex),
+	end_(kNullIndex), free_list_(kNullIndex), live_count_(0),
+	allocation_counts_(), free_counts_(), released_count_(0) {}
+NodeArena::~NodeArena() {
+	std::lock_guard<std::mutex> lock(chunk_table_mutex_);
+	for (uint32_t chunk : chunks_) {
+		delete[] chunk_table_[chunk];
+		chunk_table_[chunk] = nullptr;
+		unused_chunks_.push_back(chunk);
+	}
+}
+NodeArena* NodeArena::GetCurrent() {
+	if (current_) {
+		return current_;
+	}
+	static thread_local NodeArena fallback;
+	return &fallback;
+}
+void NodeArena::SetPhase(Phase phase) {
+	phase_ = phase;
+}
+uint32_t NodeArena::Allocate() {
+	++live_count_;
+	++allocation_counts_[static_cast<size_t>(phase_)];
+	if (free_list_ != kNullIndex) {
+		uint32_t index = free_list_;
+		std::memcpy(&free_list_, GetSlot(index), sizeof(free_list_));
+		return index;
+	}
+	if (next_ == end_) {
+		AddChunk();
+	}
+	return next_++;
+}
+void NodeArena::Free(uint32_t index) {
+	--live_count_;
+	++free_counts_[static_cast<size_t>(phase_)];
+	std::memcpy(GetSlot(index), &free_list_, sizeof(free_list_));
+	free_list_ = index;
+}
+void NodeArena::Release() {
+	released_count_ += live_count_;
+	live_count_ = 0;
+	free_list_ = kNullIndex;
+	next_chunk_ = 0;
+	next_ = kNullIndex;
+	end_ = kNullIndex;
+}
+size_t NodeArena::GetReservedBytes() {
+	return chunks_.size() * (kSlotMask + 1) * kSlotSize;
+}
+void NodeArena::AddChunk() {
+	if (next_chunk_ == chunks_.size()) {
+		std::lock_guard<std::mutex> lock(chunk_table_mutex_);
+		uint32_t chunk;
+		if (!unused_chunks_.empty()) {
+			chunk = unused_chunks_.back();
+			unused_chunks_.pop_back();
+		} else if (chunk_count_ < kMaxChunks - 1) {
+			/* The last entry is skipped so `end_` can't wrap around to 0. */
+			chunk = chunk_count_++;
+		} else {
+			std::cerr << "Out of node slots!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		chunk_table_[chunk] = new char[(kSlotMask + 1) * kSlotSize];
+		chunks_.push_back(chunk);
+	}
+	uint32_t chunk = chunks_[next_chunk_++];
+	next_ = chunk << kChunkShift;
+	end_ = next_ + kSlotMask + 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * node_arena.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class	NodeArena
+ * Pool the nodes of the trees are allocated from.  Every node takes one
+ * fixed-size slot, and a slot is named by a 32-bit index rather than a
+ * pointer so the nodes can link to each other in half the space.  Slots are
+ * carved out of large chunks, and freed slots are kept on a free list so
+ * the next allocation reuses them.  Nothing allocated from an arena has a
+ * destructor to run, so `Release()` or destroying the arena frees everything
+ * in it at once, no matter how many trees it holds.  A released arena keeps
+ * its chunks and hands them out again, so an arena that is released and
+ * refilled every generation stops asking the system for memory once it is
+ * big enough.
+ *
+ * The chunks of every arena are listed in one table shared by all threads,
+ * so `GetSlot()` can find a slot from its index alone, whichever arena it
+ * came from.  Index 0 never names a slot and stands in for a null pointer.
+ *
+ * An arena isn't thread safe.  Each thread allocates from the arena made
+ * current by the innermost `NodeArena::Scope` on that thread, or from a
+ * fallback arena of its own that lasts as long as the thread if there is
+ * none.  A slot has to be freed to the arena it came from, or to one that
+ * will be released or destroyed at the same time.
+ */
+class NodeArena {
+public:
+	/**
+	 * @class	Scope
+	 * Makes an arena the current arena of the calling thread until the
+	 * scope ends, when the previous one is restored.
+	 */
+	class Scope {
+	public:
+		explicit Scope(NodeArena *arena);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		NodeArena *previous_;
+	};
+
+	/**
+	 * What the thread allocating or freeing a slot is doing, so the slots
+	 * allocated and freed can be counted separately for each stage of a
+	 * generation.
+	 */
+	enum class Phase : uint8_t {
+		kInit,
+		kSelection,
+		kCrossover,
+		kMutation,
+		kSimplification,
+		kEvaluation
+	};
+	/** Number of values of `Phase`. */
+	static const size_t kPhaseCount = 6;
+	/** Size in bytes of a slot, which `Node` has to fit exactly. */
+	static const size_t kSlotSize = 32;
+	/** The index of no slot at all. */
+	static const uint32_t kNullIndex = 0;
+
+	NodeArena();
+	/** Release every chunk, and so everything allocated from the arena. */
+	~NodeArena();
+	NodeArena(const NodeArena&) = delete;
+	NodeArena& operator=(const NodeArena&) = delete;
+	/** Return the arena the calling thread allocates from. */
+	static NodeArena* GetCurrent();
+	/**
+	 * Set what the calling thread is doing, for the slots it allocates and
+	 * frees from now on.  A thread starts in `Phase::kInit`.
+	 */
+	static void SetPhase(Phase phase);
+	/** Return the index of an unused slot. */
+	uint32_t Allocate();
+	/** Return a slot from `Allocate()` for reuse. */
+	void Free(uint32_t index);
+	/**
+	 * Free everything allocated from the arena at once, keeping the chunks
+	 * to allocate from again.
+	 */
+	void Release();
+	/** Returns the number of bytes taken from the system for chunks. */
+	size_t GetReservedBytes();
+	/** Return the number of slots allocated and not yet freed. */
+	size_t GetLiveCount() {
+		return live_count_;
+	}
+	/** Return the number of slots allocated so far during `phase`. */
+	uint64_t GetAllocationCount(Phase phase) {
+		return allocation_counts_[static_cast<size_t>(phase)];
+	}
+	/**
+	 * Return the number of slots freed so far during `phase`, not counting
+	 * the ones freed all at once by `Release()`.
+	 */
+	uint64_t GetFreeCount(Phase phase) {
+		return free_counts_[static_cast<size_t>(phase)];
+	}
+	/** Return the number of slots freed so far by `Release()`. */
+	uint64_t GetReleasedCount() {
+		return released_count_;
+	}
+	/** Return the address of a slot from any arena. */
+	static void* GetSlot(uint32_t index) {
+		return chunk_table_[index >> kChunkShift] +
+			   (index & kSlotMask) * kSlotSize;
+	}
+
+private:
+	/** A chunk holds 2 to the power of this many slots. */
+	static const uint32_t kChunkShift = 12;
+	/** Mask for the position of a slot within its chunk. */
+	static const uint32_t kSlotMask = (1u << kChunkShift) - 1;
+	/** Number of entries in the chunk table. */
+	static const size_t kMaxChunks = size_t(1) << (32 - kChunkShift);
+
+	/**
+	 * Move on to the next chunk, reusing a released chunk if there is one
+	 * and adding one to the chunk table otherwise.
+	 */
+	void AddChunk();
+
+	std::vector<uint32_t> chunks_; /**< Chunk table entries of the arena. */
+	size_t next_chunk_; /**< Position in `chunks_` of the next chunk. */
+	uint32_t next_; /**< Next unused slot of the newest chunk. */
+	uint32_t end_; /**< One past the last slot of the newest chunk. */
+	uint32_t free_list_; /**< Freed slots, linked through their first word. */
+	size_t live_count_; /**< Slots allocated and not yet freed. */
+	uint64_t allocation_counts_[kPhaseCount]; /**< Allocations by phase. */
+	uint64_t free_counts_[kPhaseCount]; /**< Frees by phase. */
+	uint64_t released_count_; /**< Slots freed by `Release()`. */
+	/** What this thread is doing, set by `SetPhase()`. */
+	static thread_local Phase phase_;
+	/** The arena made current by the innermost `Scope` of this thread. */
+	static thread_local NodeArena *current_;
+	/** Chunks of all arenas by number.  Entry 0 is never used. */
+	static char *chunk_table_[kMaxChunks];
+	/** Numbers of entries freed by destroyed arenas, for reuse. */
+	static std::vector<uint32_t> unused_chunks_;
+	/** Number of chunk table entries handed out so far. */
+	static uint32_t chunk_count_;
+	/** Guards changes to the chunk table. */
+	static std::mutex chunk_table_mutex_;
+};
@@ -25,10 +25,13 @@
  * @date 23 November 2015
  */
 #pragma once
+
+#include <cstdint>
 /**
- * Enumerated class of possible actions of an Ant.
+ * Enumerated class of possible actions of an Ant.  It is a single byte so
+ * it packs tightly into a `Node`.
  */
-enum OpType {
+enum OpType : uint8_t {
 	kProg3,	/**< (Nonterminal) 3-Tuple: Execute branches from left to right. */
 	kProg2,	/**< (Nonterminal) 2-Tuple: Execute branches from left to right */
 	kIfFoodAhead, /**< (Nonterminal) Check if there's food one space ahead */
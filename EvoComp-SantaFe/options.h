@@ -22,6 +22,7 @@
  * @date 15 December 2015
  */
 #pragma once
+#include <cstdint>
 #include <vector>
 
 /**
@@ -37,6 +38,7 @@ struct Options {
 	double nonterminal_crossover_rate_ = 0.90;
 	double proportional_tournament_rate_ = 0.7; /* Between 0 and 1 */
 	size_t tournament_size_ = 5;
+	size_t elitism_count_ = 1;
 	size_t tree_depth_min_ = 3;
 	size_t tree_depth_max_ = 6;
 	std::vector<std::string> map_files_;
@@ -46,7 +48,25 @@ struct Options {
 	std::string output_file_ = "sf_output.csv";
 	std::string secondary_output_file_ = "sf_secondary_output.csv";
 	std::string verification_output_file_ = "sf_verification_output.csv";
+	std::string memory_output_file_; /* Empty disables memory output */
 	bool secondary_maps_exist_;
 	bool verification_maps_exist_;
 	bool graphviz_output_;
+	bool batch_evaluation_ = false;
+	bool linear_genome_ = false;
+	bool shared_trees_ = false;
+	bool steady_state_ = false;
+	bool fitness_cache_ = false;
+	size_t simplify_interval_ = 0;
+	size_t thread_count_ = 1;
+	size_t island_count_ = 0; /* Zero evolves a single population */
+	size_t migration_interval_ = 10;
+	size_t migration_size_ = 1;
+	std::string migration_topology_ = "ring"; /* "ring" or "random" */
+	bool island_processes_ = false;
+	std::string island_socket_; /* Empty picks a temporary path */
+	bool island_worker_;
+	size_t island_index_ = 0;
+	uint64_t seed_ = 0; /* Zero picks a random seed */
+	std::string fitness_cache_file_;
 };
\ No newline at end of file
@@ -19,17 +19,68 @@
  */
 
 #include "population.h"
-#include <algorithm> /* std::sort */
+#include <algorithm> /* std::sort, std::nth_element, std::fill */
+#include <cfloat> /* DBL_MIN, DBL_MAX */
 #include <iostream> /* Logging/error reporting only */
 #include <sstream>
+#include <unordered_map>
 #include <utility> /* std::swap */
+#include "batch_evaluator.h"
+#include "subtree_table.h"
+
+namespace {
+
+/**
+ * Map a draw from one fewer value than the population to a position,
+ * skipping `skipped`.  A `skipped` past the end skips nothing.
+ */
+size_t SkipDrawn(size_t draw, size_t skipped) {
+	return draw + (draw >= skipped ? 1 : 0);
+}
+/**
+ * Map a draw from two fewer values than the population to a position,
+ * skipping `a` and `b`, which differ.  A `b` past the end only skips `a`,
+ * for a draw from one fewer value.
+ */
+size_t SkipDrawn(size_t draw, size_t a, size_t b) {
+	size_t low = std::min(a, b);
+	size_t high = std::max(a, b);
+	draw += (draw >= low ? 1 : 0);
+	return draw + (draw >= high ? 1 : 0);
+}
+/**
+ * Number of times a second parent that is the first one is drawn again.
+ * After that the first parent is left out of the draw, so a population
+ * where one individual wins every tournament can't stall selection.
+ */
+const size_t kMaxParentRedraws = 100;
+
+}
 
 Population::Population(size_t population_size, double mutation_rate,
 					   double nonterminal_crossover_rate, 
 					   size_t tournament_size, 
 					   double proportional_tournament_rate, size_t depth_min, 
-					   size_t depth_max, std::vector<TrailMap*> maps) {
+					   size_t depth_max,
+					   std::vector<const MapDefinition*> maps,
+					   bool batch_evaluation, FitnessCache *fitness_cache,
+					   size_t simplify_interval, ThreadPool *thread_pool,
+					   uint64_t seed, bool linear_genome, bool shared_trees,
+					   size_t elitism_count, bool steady_state) {
 	maps_ = maps;
+	map_set_hash_ = FitnessCache::HashMapSet(maps_);
+	batch_evaluation_ = batch_evaluation;
+	linear_genome_ = linear_genome;
+	shared_trees_ = shared_trees;
+	elitism_count_ = std::min(elitism_count, population_size);
+	scored_count_ = 0;
+	steady_state_ = steady_state;
+	fitness_cache_ = fitness_cache;
+	simplify_interval_ = simplify_interval;
+	thread_pool_ = thread_pool;
+	rng_ = Rng(seed != 0 ? seed : Rng::GetRandomSeed());
+	generation_ = 0;
+	simplified_nodes_ = 0;
 	mutation_rate_ = mutation_rate;
 	nonterminal_crossover_rate_ = nonterminal_crossover_rate;
 	tournament_size_ = tournament_size;
@@ -47,73 +98,313 @@ Population::Population(size_t population_size, double mutation_rate,
 	if (depth_min > depth_max) {
 		std::swap(depth_min, depth_max);
 	}
+	arenas_ = CreateArenas();
+	spare_arenas_ = CreateArenas();
+	SumArenaCounts(allocation_base_, free_base_, released_base_);
+	NodeArena::Scope scope(arenas_[0].get());
+	NodeArena::SetPhase(NodeArena::Phase::kInit);
 	RampedHalfAndHalf(population_size, depth_min, depth_max);
 	CalculateTreeSize();
 	CalculateFitness();
 }
-Population::Population(Options opts, std::vector<TrailMap*> maps) : 
+Population::Population(Options opts,
+					   std::vector<const MapDefinition*> maps,
+					   FitnessCache *fitness_cache, ThreadPool *thread_pool) : 
 	Population(opts.population_size_, opts.mutation_rate_, 
 			   opts.nonterminal_crossover_rate_, opts.tournament_size_, 
 			   opts.proportional_tournament_rate_, opts.tree_depth_min_, 
-			   opts.tree_depth_max_, maps) {}
+			   opts.tree_depth_max_, maps, opts.batch_evaluation_,
+			   fitness_cache, opts.simplify_interval_, thread_pool,
+			   opts.seed_, opts.linear_genome_, opts.shared_trees_,
+			   opts.elitism_count_, opts.steady_state_) {}
 Population::Population(const Population &copy, 
-					   std::vector<TrailMap*> new_maps) {
+					   std::vector<const MapDefinition*> new_maps) {
 	maps_ = new_maps;
+	map_set_hash_ = FitnessCache::HashMapSet(maps_);
 	mutation_rate_ = copy.mutation_rate_;
 	nonterminal_crossover_rate_ = copy.nonterminal_crossover_rate_;
 	tournament_size_ = copy.tournament_size_;
 	proportional_tournament_rate_ = copy.proportional_tournament_rate_;
+	batch_evaluation_ = copy.batch_evaluation_;
+	linear_genome_ = copy.linear_genome_;
+	shared_trees_ = copy.shared_trees_;
+	fitness_cache_ = copy.fitness_cache_;
+	simplify_interval_ = copy.simplify_interval_;
+	thread_pool_ = copy.thread_pool_;
+	rng_ = copy.rng_.Split(map_set_hash_);
+	generation_ = copy.generation_;
+	simplified_nodes_ = copy.simplified_nodes_;
 
 	best_index_ = copy.best_index_;
+	elitism_count_ = copy.elitism_count_;
+	elites_ = copy.elites_;
+	fitnesses_ = copy.fitnesses_;
+	tree_sizes_ = copy.tree_sizes_;
+	scored_count_ = 0;
+	steady_state_ = copy.steady_state_;
 
 	best_fitness_ = copy.best_fitness_;
 	worst_fitness_ = copy.worst_fitness_;
 	avg_fitness_ = copy.avg_fitness_;
+	steps_saved_ = copy.steps_saved_;
+	cache_hits_ = copy.cache_hits_;
 
 	largest_tree_ = copy.largest_tree_;
 	smallest_tree_ = copy.smallest_tree_;
 	avg_tree_ = copy.avg_tree_;
 
-	pop_.resize(copy.pop_.size());
-	for (size_t i = 0; i < copy.pop_.size(); ++i) {
-		Individual new_individual(copy.pop_[i]);
-		pop_[i] = new_individual;
+	arenas_ = CreateArenas();
+	spare_arenas_ = CreateArenas();
+	SumArenaCounts(allocation_base_, free_base_, released_base_);
+	NodeArena::Scope scope(arenas_[0].get());
+	NodeArena::SetPhase(NodeArena::Phase::kInit);
+	pop_.reserve(copy.pop_.size());
+	for (const Individual &individual : copy.pop_) {
+		pop_.emplace_back(individual);
 	}
 }
 void Population::Evolve() {
-	std::vector<Individual> evolved_pop(pop_.size());
-	evolved_pop[0] = pop_[best_index_];
-
-	/* Non-elite individual selection. */
-	double parsimony_coefficient = CalculateParsimonyCoefficient();
-	for (size_t i = 1; i < evolved_pop.size(); ++i) {
-		size_t p1 = SelectIndividual(parsimony_coefficient);
-		size_t p2;
-		do {
-			p2 = SelectIndividual(parsimony_coefficient);
-		} while (p2 == p1);
-
-		Individual parent1(pop_[p1]);
-		Individual parent2(pop_[p2]);
-		Crossover(&parent1, &parent2);
-
-		evolved_pop[i] = parent1;
-		evolved_pop[i].Mutate(mutation_rate_);
-	}
-	this->pop_ = evolved_pop;
+	if (steady_state_) {
+		EvolveSteadyState();
+	} else {
+		EvolveGenerational();
+	}
+}
+void Population::EvolveGenerational() {
+	/*
+	 * The next generation is built in the spare buffers, which still hold
+	 * the generation before this one.  Releasing the spare arenas recycles
+	 * the nodes of those trees, and assigning over the spare individuals
+	 * reuses their genomes and score storage, so once the buffers have
+	 * grown to fit the run a generation barely touches the heap.
+	 */
+	SumArenaCounts(allocation_base_, free_base_, released_base_);
+	arenas_.swap(spare_arenas_);
+	for (std::unique_ptr<NodeArena> &arena : arenas_) {
+		arena->Release();
+	}
+	NodeArena::Scope scope(arenas_[0].get());
+
+	NodeArena::SetPhase(NodeArena::Phase::kSelection);
+	spare_pop_.resize(pop_.size());
+	for (size_t i = 0; i < elitism_count_; ++i) {
+		/* The nodes are copied, since the old arenas are released next. */
+		Individual &elite = pop_[elites_[i]];
+		spare_pop_[i] = elite;
+		spare_pop_[i].SetScores(elite.GetScores());
+	}
+
+	/* 
+	 * Non-elite individual selection.  Each child only reads the current
+	 * population and its parents, and draws from its own generator, so the
+	 * children can be built in any order, on any thread, and still come
+	 * out the same.
+	 */
+	SelectParents();
+	RunTasks(spare_pop_.size() - elitism_count_,
+			 [&](size_t /* worker */, size_t task) {
+		size_t i = task + elitism_count_;
+		Rng rng = GetChildRng(i);
+		size_t p1 = parents_[2 * task];
+		size_t p2 = parents_[2 * task + 1];
+
+		Individual &child = spare_pop_[i];
+		NodeArena::SetPhase(NodeArena::Phase::kSelection);
+		child = pop_[p1];
+		NodeArena::SetPhase(NodeArena::Phase::kCrossover);
+		Crossover(&child, pop_[p2], rng);
+		NodeArena::SetPhase(NodeArena::Phase::kMutation);
+		child.Mutate(mutation_rate_, rng);
+	});
+	pop_.swap(spare_pop_);
+	scored_count_ = elitism_count_;
+
+	++generation_;
+	simplified_nodes_ = 0;
+	if (simplify_interval_ != 0 && generation_ % simplify_interval_ == 0) {
+		/* A simplified elite is simulated again rather than trusted. */
+		scored_count_ = 0;
+		SimplifyTrees();
+	}
 	CalculateTreeSize();
 	CalculateFitness();
 }
+void Population::EvolveSteadyState() {
+	/*
+	 * Nodes are freed one tree at a time as losers are replaced, into the
+	 * arena of whichever worker replaced them, so the arenas are never
+	 * released.
+	 */
+	SumArenaCounts(allocation_base_, free_base_, released_base_);
+	if (pop_.size() < 2) {
+		std::cerr << "Crossover needs at least two individuals" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (!slots_) {
+		slots_.reset(new Slot[pop_.size()]);
+		offspring_.resize(arenas_.size());
+	}
+	for (size_t i = 0; i < pop_.size(); ++i) {
+		slots_[i].fitness = pop_[i].GetFitness();
+		slots_[i].tree_size = pop_[i].GetTreeSize();
+	}
+
+	std::atomic<size_t> steps_saved(0);
+	std::atomic<size_t> cache_hits(0);
+	RunTasks(pop_.size(), [&](size_t worker, size_t task) {
+		Rng rng = GetChildRng(task);
+		NodeArena::SetPhase(NodeArena::Phase::kSelection);
+		size_t p1 = SelectSlot(false, pop_.size(), rng);
+		size_t p2 = SelectSlot(false, pop_.size(), rng);
+		for (size_t redraw = 0; p2 == p1; ++redraw) {
+			p2 = SelectSlot(false, redraw < kMaxParentRedraws ?
+								   pop_.size() : p1, rng);
+		}
+
+		/* Only one individual is locked at a time, so none can deadlock. */
+		Individual &child = offspring_[worker];
+		{
+			std::lock_guard<std::mutex> lock(slots_[p1].mutex);
+			child = pop_[p1];
+		}
+		NodeArena::SetPhase(NodeArena::Phase::kCrossover);
+		{
+			std::lock_guard<std::mutex> lock(slots_[p2].mutex);
+			Crossover(&child, pop_[p2], rng);
+		}
+		NodeArena::SetPhase(NodeArena::Phase::kMutation);
+		child.Mutate(mutation_rate_, rng);
+
+		NodeArena::SetPhase(NodeArena::Phase::kEvaluation);
+		static thread_local FitnessCache::Scores scores;
+		if (fitness_cache_ &&
+			fitness_cache_->Find(child.GetHash(), map_set_hash_,
+								 child.GetTreeSize(), scores)) {
+			child.SetScores(scores);
+			++cache_hits;
+		} else {
+			child.CalculateScores(maps_);
+			steps_saved += child.GetStepsSaved();
+			if (fitness_cache_) {
+				fitness_cache_->Insert(child.GetHash(), map_set_hash_,
+									   child.GetTreeSize(), child.GetScores());
+			}
+		}
+		child.CalculateFitness();
+
+		NodeArena::SetPhase(NodeArena::Phase::kSelection);
+		size_t loser = SelectSlot(true, pop_.size(), rng);
+		{
+			std::lock_guard<std::mutex> lock(slots_[loser].mutex);
+			pop_[loser].Swap(child);
+			slots_[loser].fitness = pop_[loser].GetFitness();
+			slots_[loser].tree_size = pop_[loser].GetTreeSize();
+		}
+		/* The loser's tree is no longer reachable by any other task. */
+		child.Erase();
+	});
+
+	++generation_;
+	simplified_nodes_ = 0;
+	if (simplify_interval_ != 0 && generation_ % simplify_interval_ == 0) {
+		SimplifyTrees();
+		CalculateTreeSize();
+		CalculateFitness();
+		return;
+	}
+	CalculateTreeSize();
+	SummarizeFitness();
+	steps_saved_ = steps_saved;
+	cache_hits_ = cache_hits;
+}
+void Population::SimplifyTrees() {
+	std::vector<size_t> removed(pop_.size());
+	RunTasks(pop_.size(), [this, &removed](size_t /* worker */, size_t i) {
+		NodeArena::SetPhase(NodeArena::Phase::kSimplification);
+		removed[i] = pop_[i].Simplify();
+	});
+	for (size_t count : removed) {
+		simplified_nodes_ += count;
+	}
+}
 void Population::CalculateFitness() {
+	steps_saved_ = 0;
+	cache_hits_ = 0;
+
+	/* 
+	 * Only simulate trees that aren't cached and that don't duplicate an
+	 * earlier tree of this generation; the duplicates copy its scores.
+	 */
+	std::vector<size_t> pending;
+	std::vector<std::pair<size_t, size_t>> duplicates;
+	if (fitness_cache_) {
+		std::unordered_map<uint64_t, size_t> first_with_hash;
+		FitnessCache::Scores scores;
+		for (size_t i = 0; i < pop_.size(); ++i) {
+			uint64_t hash = pop_[i].GetHash();
+			auto first = first_with_hash.find(hash);
+			if (i < scored_count_) {
+				first_with_hash.emplace(hash, i);
+			} else if (first != first_with_hash.end() &&
+					   tree_sizes_[first->second] == tree_sizes_[i]) {
+				duplicates.emplace_back(std::make_pair(i, first->second));
+			} else if (fitness_cache_->Find(hash, map_set_hash_,
+											tree_sizes_[i], scores)) {
+				pop_[i].SetScores(scores);
+				++cache_hits_;
+			} else {
+				first_with_hash.emplace(hash, i);
+				pending.emplace_back(i);
+			}
+		}
+	} else {
+		for (size_t i = scored_count_; i < pop_.size(); ++i) {
+			pending.emplace_back(i);
+		}
+	}
+	scored_count_ = 0;
+
+	/* Start on the largest trees so no worker is left with one at the end. */
+	std::stable_sort(pending.begin(), pending.end(),
+					 [this](size_t a, size_t b) {
+		return tree_sizes_[a] > tree_sizes_[b];
+	});
+	if (batch_evaluation_) {
+		CalculateScoresBatched(pending);
+	} else {
+		RunTasks(pending.size(), [this, &pending](size_t /* worker */,
+													   size_t i) {
+			NodeArena::SetPhase(NodeArena::Phase::kEvaluation);
+			pop_[pending[i]].CalculateScores(maps_);
+		});
+		for (size_t i : pending) {
+			steps_saved_ += pop_[i].GetStepsSaved();
+		}
+	}
+	if (fitness_cache_) {
+		for (size_t i : pending) {
+			fitness_cache_->Insert(pop_[i].GetHash(), map_set_hash_,
+								   tree_sizes_[i], pop_[i].GetScores());
+		}
+		for (auto duplicate : duplicates) {
+			pop_[duplicate.first].SetScores(
+				pop_[duplicate.second].GetScores());
+			++cache_hits_;
+		}
+	}
+	SummarizeFitness();
+}
+void Population::SummarizeFitness() {
 	double cur_fitness = 0;
 	avg_fitness_ = 0;
 	best_fitness_ = DBL_MIN;
 	worst_fitness_ = DBL_MAX;
 
+	fitnesses_.resize(pop_.size());
 	for (size_t i = 0; i < pop_.size(); ++i) {
-		pop_[i].CalculateScores(maps_);
 		pop_[i].CalculateFitness();
 		cur_fitness = pop_[i].GetFitness();
+		fitnesses_[i] = cur_fitness;
 		avg_fitness_ += cur_fitness;
 		if (cur_fitness > best_fitness_) {
 			best_fitness_ = cur_fitness;
@@ -130,8 +421,10 @@ void Population::CalculateTreeSize() {
 	largest_tree_ = -1;
 	smallest_tree_ = SIZE_MAX;
 
-	for (auto p : pop_) {
-		cur_tree = p.GetTreeSize();
+	tree_sizes_.resize(pop_.size());
+	for (size_t i = 0; i < pop_.size(); ++i) {
+		cur_tree = pop_[i].GetTreeSize();
+		tree_sizes_[i] = static_cast<uint32_t>(cur_tree);
 		avg_tree_ += cur_tree;
 		if (cur_tree > largest_tree_) {
 			largest_tree_ = cur_tree;
@@ -142,8 +435,10 @@ void Population::CalculateTreeSize() {
 	total_nodes_ = avg_tree_;
 	avg_tree_ = avg_tree_ / pop_.size();
 }
-void Population::SetMaps(std::vector<TrailMap*> maps) {
+void Population::SetMaps(std::vector<const MapDefinition*> maps) {
 	maps_ = maps;
+	map_set_hash_ = FitnessCache::HashMapSet(maps_);
+	scored_count_ = 0;
 }
 std::string Population::ToString(bool include_fitness, bool latex) {
 	std::stringstream ss;
@@ -188,6 +483,76 @@ double Population::GetWorstFitness() {
 double Population::GetAverageFitness() {
 	return avg_fitness_;
 }
+size_t Population::GetStepsSaved() {
+	return steps_saved_;
+}
+size_t Population::GetCacheHitCount() {
+	return cache_hits_;
+}
+size_t Population::GetSimplifiedNodeCount() {
+	return simplified_nodes_;
+}
+uint64_t Population::GetSeed() {
+	return rng_.GetSeed();
+}
+void Population::Emigrate(size_t count, std::vector<Individual> &migrants) {
+	static thread_local std::vector<uint32_t> best;
+	RankIndividuals(count, false, best);
+	/* A `Node` tree is copied into the arena only to be shared and freed. */
+	NodeArena::Scope scope(arenas_[0].get());
+	migrants.resize(best.size());
+	for (size_t i = 0; i < best.size(); ++i) {
+		migrants[i] = pop_[best[i]];
+		migrants[i].SetScores(pop_[best[i]].GetScores());
+		migrants[i].SetShared(!linear_genome_);
+	}
+}
+void Population::Immigrate(std::vector<Individual> &migrants) {
+	static thread_local std::vector<uint32_t> worst;
+	RankIndividuals(migrants.size(), true, worst);
+	NodeArena::Scope scope(arenas_[0].get());
+	for (size_t i = 0; i < worst.size(); ++i) {
+		/* The replaced tree belongs to one of the arenas of `pop_`. */
+		Individual &individual = pop_[worst[i]];
+		individual.Erase();
+		individual = migrants[i];
+		individual.SetScores(migrants[i].GetScores());
+		individual.SetShared(shared_trees_);
+	}
+	CalculateTreeSize();
+	SummarizeFitness();
+}
+MemoryUsage Population::GetMemoryUsage() {
+	MemoryUsage usage;
+	for (auto *arenas : { &arenas_, &spare_arenas_ }) {
+		for (std::unique_ptr<NodeArena> &arena : *arenas) {
+			usage.live_nodes += arena->GetLiveCount();
+			usage.arena_bytes += arena->GetReservedBytes();
+		}
+	}
+	usage.node_bytes = usage.live_nodes * NodeArena::kSlotSize;
+	SumArenaCounts(usage.allocations, usage.frees, usage.released);
+	for (size_t phase = 0; phase < NodeArena::kPhaseCount; ++phase) {
+		usage.allocations[phase] -= allocation_base_[phase];
+		usage.frees[phase] -= free_base_[phase];
+	}
+	usage.released -= released_base_;
+
+	usage.subtree_count = SubtreeTable::GetEntryCount();
+	usage.subtree_bytes = SubtreeTable::GetReservedBytes();
+	for (auto *individuals : { &pop_, &spare_pop_ }) {
+		for (Individual &individual : *individuals) {
+			usage.genome_bytes += individual.GetGenomeBytes();
+			usage.score_bytes += individual.GetScoreBytes();
+			usage.program_bytes += individual.GetProgramBytes();
+		}
+	}
+	for (const MapDefinition *map : maps_) {
+		usage.map_bytes += map->GetReservedBytes();
+	}
+	usage.resident_bytes = GetResidentBytes();
+	return usage;
+}
 std::vector<std::string> Population::GetBestSolutionMap(bool latex) {
 	return pop_[best_index_].PrintSolvedMap(maps_, latex);
 }
@@ -204,28 +569,105 @@ void Population::RampedHalfAndHalf(size_t population_size, size_t depth_min,
 		} else {
 			full_tree = false;
 		}
-		pop_.emplace_back(Individual((depth_min + i % gradations), full_tree));
+		Rng rng = rng_.Split(0).Split(i);
+		pop_.emplace_back((depth_min + i % gradations), full_tree, rng,
+						  linear_genome_, shared_trees_);
 	}
 }
-void Population::Crossover(Individual *parent1, Individual *parent2) {
-	std::uniform_real_distribution<double> d{ 0,1 };
-	bool p1_nonterminal = ((d(GetEngine())) < nonterminal_crossover_rate_);
-	bool p2_nonterminal = ((d(GetEngine())) < nonterminal_crossover_rate_);
+void Population::CalculateScoresBatched(const std::vector<size_t> &indices) {
+	const size_t kChunkSize = BatchEvaluator::kLaneCount * 16;
+	size_t chunk_count = (indices.size() + kChunkSize - 1) / kChunkSize;
+	std::vector<size_t> chunk_steps_saved(chunk_count, 0);
 
-	std::pair<Node*, size_t> c1 = parent1->GetRandomNode(p1_nonterminal);
-	std::pair<Node*, size_t> c2 = parent2->GetRandomNode(p2_nonterminal);
+	/* Each chunk gets its own evaluators, and so its own copy of the food. */
+	RunTasks(chunk_count, [&](size_t /* worker */, size_t chunk) {
+		NodeArena::SetPhase(NodeArena::Phase::kEvaluation);
+		size_t first = chunk * kChunkSize;
+		size_t last = std::min(first + kChunkSize, indices.size());
+		std::vector<Program*> programs;
+		std::vector<std::vector<std::pair<size_t, size_t>>> scores(
+			last - first);
 
-	/* c1.first could be a nullptr in which case new individual is c2 */
-	if (!c1.first->GetParent()) {
-		c2.first->SetParent(nullptr);
+		for (size_t i = first; i < last; ++i) {
+			programs.emplace_back(pop_[indices[i]].GetProgram());
+		}
+		for (const MapDefinition *map : maps_) {
+			BatchEvaluator evaluator(map);
+			std::vector<size_t> consumed = evaluator.Evaluate(programs);
+			chunk_steps_saved[chunk] += evaluator.GetStepsSaved();
+			for (size_t i = 0; i < consumed.size(); ++i) {
+				scores[i].emplace_back(std::make_pair(
+					consumed[i], map->GetTotalFoodCount()));
+			}
+		}
+		for (size_t i = first; i < last; ++i) {
+			pop_[indices[i]].SetScores(scores[i - first]);
+		}
+	});
+	for (size_t steps_saved : chunk_steps_saved) {
+		steps_saved_ += steps_saved;
+	}
+}
+void Population::RunTasks(size_t task_count, const ThreadPool::Task &task) {
+	if (thread_pool_) {
+		thread_pool_->Run(task_count, [this, &task](size_t worker, size_t i) {
+			NodeArena::Scope scope(arenas_[worker].get());
+			task(worker, i);
+		});
+	} else {
+		NodeArena::Scope scope(arenas_[0].get());
+		for (size_t i = 0; i < task_count; ++i) {
+			task(0, i);
+		}
+	}
+}
+void Population::Crossover(Individual *parent1, Individual &parent2,
+						   Rng &rng) {
+	bool p1_nonterminal = rng.NextBernoulli(nonterminal_crossover_rate_);
+	bool p2_nonterminal = rng.NextBernoulli(nonterminal_crossover_rate_);
+
+	if (parent1->IsLinear()) {
+		size_t position1 = parent1->GetRandomPosition(p1_nonterminal, rng);
+		size_t position2 = parent2.GetRandomPosition(p2_nonterminal, rng);
+		parent1->GetGenome()->Splice(position1, *parent2.GetGenome(),
+									 position2);
+		parent1->CorrectTree();
+		return;
+	}
+	if (parent1->IsShared()) {
+		size_t position1 = parent1->GetRandomPosition(p1_nonterminal, rng);
+		size_t position2 = parent2.GetRandomPosition(p2_nonterminal, rng);
+		parent1->GetSharedTree()->Splice(position1, *parent2.GetSharedTree(),
+										 position2);
+		parent1->CorrectTree();
+		return;
+	}
+
+	/* The path down to the crossover point, to correct the counts along. */
+	static thread_local std::vector<Node*> ancestors;
+	std::pair<Node*, size_t> c1 = parent1->GetRandomNode(p1_nonterminal,
+														 &ancestors, rng);
+	std::pair<Node*, size_t> c2 = parent2.GetRandomNode(p2_nonterminal,
+														nullptr, rng);
+
+	/* Only the subtree taken from parent2 is copied. */
+	Node *graft = Node::Create();
+	graft->Copy(c2.first);
+
+	/* c1.first could be the root in which case new individual is c2 */
+	if (ancestors.empty()) {
 		parent1->Erase();
-		parent1->SetRootNode(c2.first);
+		parent1->SetRootNode(graft);
 	} else {
-		Node *parent = c1.first->GetParent();
-		c2.first->SetParent(parent);
-		if (parent->GetChild(c1.second)) { /* Make sure not a terminal */
-			parent->GetChild(c1.second)->Erase();
-			parent->SetChild(c1.second, c2.first);
+		Node *parent = ancestors.back();
+		Node *replaced = parent->GetChild(c1.second);
+		if (replaced) { /* Make sure not a terminal */
+			parent->SetChild(c1.second, graft);
+			replaced->Erase();
+			/* The parent updated its own counts. */
+			for (size_t i = ancestors.size() - 1; i-- > 0;) {
+				ancestors[i]->UpdateCounts();
+			}
 		} else {
 			std::cerr << "Invalid child selected (" << c1.second << ")";
 			std::cerr << std::endl;
@@ -234,94 +676,167 @@ void Population::Crossover(Individual *parent1, Individual *parent2) {
 	}
 	parent1->CorrectTree();
 }
-size_t Population::SelectIndividual(double parsimony_coefficient) {
-	size_t winner;
-	size_t challenger;
-	double winner_fitness;
-	double challenger_fitness;
-	bool fitness_based;
-	
-	/* Determine whether tournment is fitness or parsimony based */
-	std::uniform_real_distribution<double> t{ 0,1 };
-	fitness_based = (t(GetEngine()) < proportional_tournament_rate_);
+void Population::SelectParents() {
+	size_t child_count = pop_.size() - elitism_count_;
+	parents_.resize(2 * child_count);
+	if (child_count == 0) {
+		return;
+	}
+	if (pop_.size() < 2) {
+		std::cerr << "Crossover needs at least two individuals" << std::endl;
+		exit(EXIT_FAILURE);
+	}
 
-	/* Run the tournament */
-	std::uniform_int_distribution<size_t> d{ 0,pop_.size() - 1 };
-	winner = d(GetEngine());
 	/*
-	winner_fitness = CalculateWeightedFitness(
-		pop_[winner].GetFitness(),
-		parsimony_coefficient,
-		static_cast<double>(pop_[winner].GetTreeSize()));
-	*/
-	winner_fitness = pop_[winner].GetFitness();
-	for (size_t i = 0; i < tournament_size_; ++i) {
-		do {
-			challenger = d(GetEngine());
-		} while (winner == challenger);
+	 * The draws are grouped by bound, one bulk fill each: the entrants of
+	 * both tournaments of every child, then their challengers, which leave
+	 * out the current winner.
+	 */
+	uint32_t pop_size = static_cast<uint32_t>(pop_.size());
+	size_t tournament_count = 2 * child_count;
+	selection_draws_.resize(tournament_count * (1 + tournament_size_));
+	uint32_t *entrants = selection_draws_.data();
+	uint32_t *challengers = entrants + tournament_count;
+	Rng rng = GetSelectionRng();
+	rng.FillBounded(pop_size, tournament_count, entrants);
+	rng.FillBounded(pop_size - 1, tournament_count * tournament_size_,
+					challengers);
+	fitness_based_.resize(tournament_count);
+	rng.FillBernoulli(proportional_tournament_rate_, fitness_based_.size(),
+					  fitness_based_.data());
 
+	for (size_t i = 0; i < tournament_count; ++i) {
+		parents_[i] = static_cast<uint32_t>(RunTournament(
+			fitness_based_[i] != 0, entrants[i],
+			challengers + i * tournament_size_, tournament_size_,
+			pop_.size()));
+	}
+	/* A second parent that is the first is drawn again, in order. */
+	for (size_t i = 0; i < child_count; ++i) {
+		size_t p1 = parents_[2 * i];
+		size_t p2 = parents_[2 * i + 1];
+		for (size_t redraw = 0; p2 == p1; ++redraw) {
+			p2 = DrawTournament(redraw < kMaxParentRedraws ?
+								pop_.size() : p1, rng);
+		}
+		parents_[2 * i + 1] = static_cast<uint32_t>(p2);
+	}
+}
+size_t Population::RunTournament(bool fitness_based, uint32_t entrant,
+								 const uint32_t *challengers, size_t count,
+								 size_t excluded) {
+	size_t winner = SkipDrawn(entrant, excluded);
+	for (size_t i = 0; i < count; ++i) {
+		size_t challenger = SkipDrawn(challengers[i], winner, excluded);
+		if (Beats(fitness_based, challenger, winner)) {
+			winner = challenger;
+		}
+	}
+	return winner;
+}
+bool Population::Beats(bool fitness_based, size_t challenger,
+					   size_t winner) const {
+	if (fitness_based) {
+		return fitnesses_[challenger] > fitnesses_[winner];
+	}
+	return tree_sizes_[challenger] < tree_sizes_[winner];
+}
+size_t Population::DrawTournament(size_t excluded, Rng &rng) {
+	bool fitness_based = rng.NextBernoulli(proportional_tournament_rate_);
+	uint32_t pop_size = static_cast<uint32_t>(pop_.size());
+	uint32_t bound = pop_size - (excluded < pop_.size() ? 1 : 0);
+	size_t winner = SkipDrawn(rng.NextBounded(bound), excluded);
+	for (size_t i = 0; bound > 1 && i < tournament_size_; ++i) {
+		size_t challenger = SkipDrawn(rng.NextBounded(bound - 1), winner,
+									  excluded);
+		if (Beats(fitness_based, challenger, winner)) {
+			winner = challenger;
+		}
+	}
+	return winner;
+}
+size_t Population::SelectSlot(bool loser, size_t excluded, Rng &rng) {
+	bool fitness_based = rng.NextBernoulli(proportional_tournament_rate_);
+	uint32_t pop_size = static_cast<uint32_t>(pop_.size());
+	/* Every draw leaves out the excluded individual, if there is one. */
+	uint32_t bound = pop_size - (excluded < pop_.size() ? 1 : 0);
+	size_t winner = SkipDrawn(rng.NextBounded(bound), excluded);
+	double winner_fitness = slots_[winner].fitness;
+	size_t winner_size = slots_[winner].tree_size;
+	for (size_t i = 0; bound > 1 && i < tournament_size_; ++i) {
+		size_t challenger = SkipDrawn(rng.NextBounded(bound - 1), winner,
+									  excluded);
+		double challenger_fitness = slots_[challenger].fitness;
+		size_t challenger_size = slots_[challenger].tree_size;
+		bool wins;
 		if (fitness_based) {
-			/*
-			challenger_fitness = CalculateWeightedFitness(
-				pop_[challenger].GetFitness(),
-				parsimony_coefficient,
-				static_cast<double>(pop_[challenger].GetTreeSize()));
-			*/
-			challenger_fitness = pop_[challenger].GetFitness();
-
-			if(challenger_fitness > winner_fitness) {
-				winner = challenger;
-				winner_fitness = challenger_fitness;
-			}
+			wins = loser ? challenger_fitness < winner_fitness
+						 : challenger_fitness > winner_fitness;
 		} else {
-			if (pop_[challenger].GetTreeSize() < pop_[winner].GetTreeSize()) {
-				winner = challenger;
-			}
+			wins = loser ? challenger_size > winner_size
+						 : challenger_size < winner_size;
+		}
+		if (wins) {
+			winner = challenger;
+			winner_fitness = challenger_fitness;
+			winner_size = challenger_size;
 		}
 	}
 	return winner;
 }
 void Population::SetElite() {
-	best_index_ = 0;
-
+	RankIndividuals(std::max<size_t>(elitism_count_, 1), false, elites_);
+	best_index_ = elites_[0];
+}
+void Population::RankIndividuals(size_t count, bool worst,
+								 std::vector<uint32_t> &ranked) {
+	count = std::min(count, pop_.size());
+	ranked.resize(pop_.size());
 	for (size_t i = 0; i < pop_.size(); ++i) {
-		if (pop_[i].GetFitness() > pop_[best_index_].GetFitness()) {
-			best_index_ = i;
+		ranked[i] = static_cast<uint32_t>(i);
+	}
+	auto first = [this, worst](uint32_t a, uint32_t b) {
+		if (fitnesses_[a] != fitnesses_[b]) {
+			return (fitnesses_[a] > fitnesses_[b]) != worst;
+		}
+		return (a < b) != worst;
+	};
+	if (count != 0) {
+		std::nth_element(ranked.begin(), ranked.begin() + count - 1,
+						 ranked.end(), first);
+		std::sort(ranked.begin(), ranked.begin() + count, first);
+	}
+	ranked.resize(count);
+}
+Rng Population::GetChildRng(size_t slot) {
+	/* Stream zero made the initial population. */
+	return rng_.Split(generation_ + 1).Split(slot);
+}
+Rng Population::GetSelectionRng() {
+	/* The slots take the streams from zero up, so this takes the last. */
+	return rng_.Split(generation_ + 1).Split(UINT64_MAX);
+}
+std::vector<std::unique_ptr<NodeArena>> Population::CreateArenas() {
+	size_t worker_count = thread_pool_ ? thread_pool_->GetThreadCount() : 1;
+	std::vector<std::unique_ptr<NodeArena>> arenas;
+	for (size_t i = 0; i < worker_count; ++i) {
+		arenas.emplace_back(new NodeArena);
+	}
+	return arenas;
+}
+void Population::SumArenaCounts(uint64_t *allocations, uint64_t *frees,
+								uint64_t &released) {
+	std::fill(allocations, allocations + NodeArena::kPhaseCount, 0);
+	std::fill(frees, frees + NodeArena::kPhaseCount, 0);
+	released = 0;
+	for (auto *arenas : { &arenas_, &spare_arenas_ }) {
+		for (std::unique_ptr<NodeArena> &arena : *arenas) {
+			for (size_t phase = 0; phase < NodeArena::kPhaseCount; ++phase) {
+				NodeArena::Phase p = static_cast<NodeArena::Phase>(phase);
+				allocations[phase] += arena->GetAllocationCount(p);
+				frees[phase] += arena->GetFreeCount(p);
+			}
+			released += arena->GetReleasedCount();
 		}
 	}
 }
-double Population::CalculateWeightedFitness(double raw_fitness, 
-											double parsimony,
-											double tree_size) {
-	return (raw_fitness - (0.5 * parsimony * tree_size));
-}
-double Population::CalculateParsimonyCoefficient() {
-	double covariance = 0;
-	double variance = 0;
-	double parsimony = 0;
-
-	double Ex = 0;
-	int Ey = 0;
-	double Exy = 0;
-	double Exx = 0;
-	double Kx = pop_[0].GetFitness();
-	int Ky = static_cast<int>(pop_[0].GetTreeSize());
-
-	double pop_size = static_cast<double>(pop_.size());
-
-	for (auto p : pop_) {
-		Ex += (p.GetFitness() - Kx);
-		Ey += (static_cast<int>(p.GetTreeSize()) - Ky);
-		Exy += (p.GetFitness() - Kx) * (p.GetTreeSize() - Ky);
-		Exx += (p.GetFitness() - Kx) * (p.GetFitness() - Kx);
-	}
-	covariance = (Exy - Ex * static_cast<double>(Ey) / pop_size) / pop_size;
-	variance = (Exx - Ex * Ex / pop_size) / pop_size;
-	parsimony = (covariance / variance);
-	return parsimony;
-}
-std::mt19937 &Population::GetEngine() {
-	static std::random_device rd;
-	static std::mt19937 mt(rd());
-	return mt;
-}
\ No newline at end of file
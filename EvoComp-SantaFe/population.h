@@ -23,11 +23,19 @@
  */
 #pragma once
 
-#include <random>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "fitness_cache.h"
 #include "individual.h"
+#include "map_definition.h"
+#include "memory_usage.h"
+#include "node_arena.h"
 #include "options.h"
-#include "trail_map.h"
+#include "rng.h"
+#include "thread_pool.h"
 
 /**
  * @class	Population
@@ -64,34 +72,95 @@ public:
 	 *												tree size.
 	 * @param[in]	maps							Vector of the different map
 	 *												files that were read in.
+	 * @param[in]	batch_evaluation				Evaluate the population
+	 *												with a `BatchEvaluator`
+	 *												instead of one individual
+	 *												at a time.
+	 * @param[in]	fitness_cache					Cache of the scores of
+	 *												trees that have already
+	 *												been simulated, or
+	 *												`nullptr` to always
+	 *												simulate.  Not owned.
+	 * @param[in]	simplify_interval				Simplify every tree once
+	 *												every this many
+	 *												generations, or never if
+	 *												zero.
+	 * @param[in]	thread_pool						Workers to make and
+	 *												evaluate the individuals
+	 *												on, or `nullptr` to use
+	 *												the calling thread.  Not
+	 *												owned.
+	 * @param[in]	seed							Seed of every random
+	 *												decision of the run, or
+	 *												zero to pick one from
+	 *												`std::random_device`.
+	 * @param[in]	linear_genome					Store the trees as
+	 *												`LinearGenome` arrays
+	 *												instead of `Node`
+	 *												objects.
+	 * @param[in]	shared_trees					Store the trees as
+	 *												`SharedTree` objects,
+	 *												sharing identical
+	 *												subtrees, instead of
+	 *												`Node` objects.
+	 * @param[in]	elitism_count					How many of the best
+	 *												individuals are carried
+	 *												into each next
+	 *												generation unchanged.
+	 * @param[in]	steady_state					Replace individuals one
+	 *												at a time instead of a
+	 *												generation at once.  See
+	 *												`Evolve()`.
 	 */
 	Population(size_t population_size, double mutation_rate, 
 			   double nonterminal_crossover_rate, size_t tournament_size, 
 			   double proportional_tournament_rate, size_t depth_min, 
-			   size_t depth_max, std::vector<TrailMap*> maps);
-	Population(Options opts, std::vector<TrailMap*> maps);
-	Population(const Population &copy, std::vector<TrailMap*> new_maps);
+			   size_t depth_max, std::vector<const MapDefinition*> maps,
+			   bool batch_evaluation = false,
+			   FitnessCache *fitness_cache = nullptr,
+			   size_t simplify_interval = 0,
+			   ThreadPool *thread_pool = nullptr, uint64_t seed = 0,
+			   bool linear_genome = false, bool shared_trees = false,
+			   size_t elitism_count = 1, bool steady_state = false);
+	Population(Options opts, std::vector<const MapDefinition*> maps,
+			   FitnessCache *fitness_cache = nullptr,
+			   ThreadPool *thread_pool = nullptr);
+	/**
+	 * Create a population with the same individuals as `copy` that
+	 * evolves against different maps.  It draws from its own random
+	 * stream, split from the one of `copy`, so the two populations
+	 * diverge.
+	 */
+	Population(const Population &copy,
+			   std::vector<const MapDefinition*> new_maps);
 	/** 
 	 * The evolve function is the wrapper for the different stages of
 	 * evolution for the genetic program.  Specifically, `Evolve()` selects
 	 * elite individuals, then completes a generation by using tournament
 	 * selection to select two parents for crossover.  After crossover, the
 	 * newly made individual is mutated.  This group becomes the population
-	 * for the next generation.
+	 * for the next generation.  The elites come first in the next
+	 * generation, best first, and keep their scores instead of being
+	 * simulated again, unless the trees were simplified.
 	 *
-	 * @param[in]	elitism_count	How many elite individuals to move from
-	 *								the current generation to the next. This
-	 *								currently isn't used and an elitism of
-	 *								two individuals is hardcoded in the
-	 *								`Elitism()` function.
-	 *
-	 * @todo	Properly implement Elitism.  Will require sorting the entire
-	 *			population.
+	 * A steady-state population instead makes as many children as it has
+	 * individuals, each by its own task that selects the parents, crosses
+	 * them over, mutates and evaluates the child and then puts it in place
+	 * of the loser of a reverse tournament.  Workers pick up the next task
+	 * as soon as they finish one, so no one waits for a whole generation to
+	 * be made before any of it is evaluated.  The tasks share the
+	 * population, locking one individual at a time.  A child can be the
+	 * parent of a later child of the same call, so the run is only
+	 * repeatable on a single thread.  Elitism and batch evaluation don't
+	 * apply.
 	 */
 	void Evolve();
 	/**
 	 * Calculate the fitness of an individual based on the genetic program
-	 * represented by the tree of an individual.
+	 * represented by the tree of an individual.  The individuals are
+	 * simulated on the thread pool, if there is one, but the best, worst
+	 * and average fitness are always reduced in population order so they
+	 * don't depend on the number of threads.
 	 */
 	void CalculateFitness();
 	/**
@@ -103,7 +172,7 @@ public:
 	 * Sets the maps that the Individuals in the population will calculuate
 	 * their fitness based on.
 	 */
-	void SetMaps(std::vector<TrailMap*> maps);
+	void SetMaps(std::vector<const MapDefinition*> maps);
 	/** 
 	 * Returns the `ToString()` function of every individual in the population.
 	 * 
@@ -175,6 +244,49 @@ public:
 	 * @return	The average raw fitness score.
 	 */
 	double GetAverageFitness();
+	/**
+	 * Returns the number of actions that the last fitness calculation
+	 * skipped because ants cleared the trail or got stuck in a loop.
+	 *
+	 * @return	The actions saved across all individuals and maps.
+	 */
+	size_t GetStepsSaved();
+	/**
+	 * Returns the number of individuals whose scores the last fitness
+	 * calculation took from the fitness cache or from an identical tree
+	 * in the same generation, instead of simulating them.
+	 */
+	size_t GetCacheHitCount();
+	/**
+	 * Returns the number of nodes removed by simplifying the trees of the
+	 * last generation, or zero if they weren't simplified.
+	 */
+	size_t GetSimplifiedNodeCount();
+	/** Returns the seed the random decisions of the run derive from. */
+	uint64_t GetSeed();
+	/**
+	 * Set `migrants` to copies of the best individuals, best first, with
+	 * their scores.  The copies are shared or linear, so they don't refer
+	 * to the arenas of the population and can be handed to another thread.
+	 *
+	 * @param[in]	count		The number of individuals to copy.
+	 * @param[out]	migrants	Resized to `count`, reusing its storage.
+	 */
+	void Emigrate(size_t count, std::vector<Individual> &migrants);
+	/**
+	 * Replace the worst individuals with copies of `migrants`, which keep
+	 * their scores, and update the fitness statistics and the elites.  The
+	 * maps of the population the migrants came from have to be the same.
+	 */
+	void Immigrate(std::vector<Individual> &migrants);
+	/**
+	 * Returns where the memory of the population goes.  The allocation and
+	 * free counts cover the last call to `Evolve()`, or the construction of
+	 * the population before the first one.  The `SubtreeTable` and the
+	 * resident set size are shared with any other population of the
+	 * process.  It mustn't be called while the population is evolving.
+	 */
+	MemoryUsage GetMemoryUsage();
 	/** Get a vector of all of the completed maps for the best solution. */
 	std::vector<std::string> GetBestSolutionMap(bool latex);
 	/** Create a GraphViz file that can be parsed by `dot` */
@@ -195,6 +307,35 @@ private:
 	 */
 	void RampedHalfAndHalf(size_t population_size, 
 						   size_t depth_min, size_t depth_max);
+	/** Make the next generation all at once.  See `Evolve()`. */
+	void EvolveGenerational();
+	/** Replace one generation's worth of losers.  See `Evolve()`. */
+	void EvolveSteadyState();
+	/**
+	 * Simplify every tree and count the nodes removed in
+	 * `simplified_nodes_`.  The scores of the trees are left as they were.
+	 */
+	void SimplifyTrees();
+	/**
+	 * Set the best, worst and average fitness and the elites from the
+	 * scores the individuals already have.
+	 */
+	void SummarizeFitness();
+	/**
+	 * Calculate the scores of the given individuals by running their
+	 * compiled programs through a `BatchEvaluator` for each map.  The
+	 * individuals are split into chunks that are evaluated as separate
+	 * tasks.
+	 *
+	 * @param[in]	indices	Positions in `pop_` of the individuals.
+	 */
+	void CalculateScoresBatched(const std::vector<size_t> &indices);
+	/**
+	 * Run a batch of tasks on the thread pool, or one after another on the
+	 * calling thread if there is no pool.  Nodes made by a task go into the
+	 * arena of the worker running it.
+	 */
+	void RunTasks(size_t task_count, const ThreadPool::Task &task);
 	/** 
 	 * Point crossover where two parents will create one offspring.  The child
 	 * is constructed by replacing a subtree in `parent1` with a subtree of
@@ -206,58 +347,180 @@ private:
 	 *								parents of the crossover operation but
 	 *								is also the actual object that is modified
 	 *								in the process.
-	 * @param[in]		parent2		This is a copy of an individual in the
-	 *								population and a subtree of this tree is
-	 *								spliced into `parent1`.
+	 * @param[in]		parent2		An individual in the population.  It is
+	 *								only read: a copy of one of its subtrees
+	 *								is spliced into `parent1`.
+	 * @param[in]		rng			The generator of the child being made.
 	 */
-	void Crossover(Individual *parent1, Individual *parent2);
-	/** 
-	 * Implements tournament selection using the weighted fitness score.  The
-	 * weighted fitness score exists because parsimony pressure is used to
-	 * help prevent code growth.
+	void Crossover(Individual *parent1, Individual &parent2, Rng &rng);
+	/**
+	 * Pick both parents of every child of the next generation into
+	 * `parents_`, by tournament selection.  All of the random draws of the
+	 * generation are made first, in bulk, and the tournaments then only
+	 * read `fitnesses_`, `tree_sizes_` and the draws in order.  A challenger
+	 * is never the current winner, without drawing again.  Both parents
+	 * come from a tournament of the whole population, and a second parent
+	 * that is the first is drawn again with `DrawTournament()`, leaving the
+	 * first out only after many tries.
 	 */
-	size_t SelectIndividual(double parsimony_coefficient);
-	/** 
-	 * Determine and set the indices of the single best individual.
+	void SelectParents();
+	/**
+	 * Return the winner of one tournament of `SelectParents()`.
+	 *
+	 * @param[in]	fitness_based	Compare fitness rather than tree size.
+	 * @param[in]	entrant			Draw of the first entrant.
+	 * @param[in]	challengers		Draws of the challengers.
+	 * @param[in]	count			Number of challengers.
+	 * @param[in]	excluded		Individual that can't enter, or the
+	 *								population size for none.
 	 */
-	void SetElite();
+	size_t RunTournament(bool fitness_based, uint32_t entrant,
+						 const uint32_t *challengers, size_t count,
+						 size_t excluded);
+	/**
+	 * Return whether `challenger` beats `winner` in a tournament of
+	 * `SelectParents()`, by fitness or else by the smaller tree.
+	 */
+	bool Beats(bool fitness_based, size_t challenger, size_t winner) const;
+	/**
+	 * Draw one tournament from `rng` and return its winner, for the rare
+	 * second parents that `SelectParents()` draws again.  The challengers
+	 * are drawn one at a time, in the order `RunTournament()` reads them.
+	 *
+	 * @param[in]	excluded	Individual that can't enter, or the
+	 *							population size for none.
+	 * @param[in]	rng			The generator to draw the entrants from.
+	 */
+	size_t DrawTournament(size_t excluded, Rng &rng);
 	/**
-	 * Calculate the weighted fitness based on raw fitness, tree size and 
-	 * parsimony coefficient.
+	 * Run the same tournament as `RunTournament()` against `slots_`, so
+	 * it can run while other tasks replace individuals, and return the
+	 * position of the winner, or of the loser if `loser` is set.  The loser
+	 * has the lowest fitness or the largest tree.
+	 *
+	 * @param[in]	loser		Find the loser instead of the winner.
+	 * @param[in]	excluded	Individual that can't enter, or the
+	 *							population size for none.
+	 * @param[in]	rng			The generator to draw the entrants from.
 	 */
-	double CalculateWeightedFitness(double raw_fitness, double parsimony,
-									double tree_size);
+	size_t SelectSlot(bool loser, size_t excluded, Rng &rng);
 	/** 
-	 * Determine the parsimony pressure for coming up with weighted fitnesses.
+	 * Determine and set the indices of the elite individuals, best first,
+	 * and of the single best individual.  Only the elites are ordered, by
+	 * partially sorting the positions of the individuals by fitness, and
+	 * ties go to the earlier individual.
 	 */
-	double CalculateParsimonyCoefficient();
+	void SetElite();
 	/**
-	 * A static random engine that can be shared throughout the entire class.
-	 * Based on the idea found in:
-	 * http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2013/n3551.pdf
-	 * This class uses the well-defined STL Mersenne Twister engine, mt19937.
-	 * The first time this method is called, a std::mt19937 engine is
-	 * initialized and seeded by `std::random_device` and is returned.  All
-	 * subsequent calls return the originally created engine.
+	 * Set `ranked` to the positions of the `count` best individuals, best
+	 * first, or of the `count` worst, worst first, by partially sorting the
+	 * positions of all of them by `fitnesses_`.  Ties go to the earlier
+	 * individual when ranking the best and to the later one otherwise.
+	 */
+	void RankIndividuals(size_t count, bool worst,
+						 std::vector<uint32_t> &ranked);
+	/**
+	 * Return the generator used to make the individual in a slot of the
+	 * next generation.  It is split from the run seed by the generation and
+	 * the slot alone, so a child is the same whichever thread makes it and
+	 * whatever order the children are made in.
 	 *
-	 * @return	A Mersenne Twister Engine seeded by `std::random_device`.
+	 * @param[in]	slot	Position of the individual in the next generation.
 	 */
-	std::mt19937 &GetEngine();
+	Rng GetChildRng(size_t slot);
+	/**
+	 * Return the generator `SelectParents()` draws the tournaments of the
+	 * next generation from, split from the run seed like `GetChildRng()`.
+	 */
+	Rng GetSelectionRng();
+	/** Create an empty arena for each worker that runs tasks. */
+	std::vector<std::unique_ptr<NodeArena>> CreateArenas();
+	/**
+	 * Add up the allocation, free and release counts of every arena of the
+	 * population so far.
+	 */
+	void SumArenaCounts(uint64_t *allocations, uint64_t *frees,
+						uint64_t &released);
 	std::vector<Individual> pop_;
-	std::vector<TrailMap*> maps_;
+	/**
+	 * The previous generation, kept so its individuals can be assigned over
+	 * when the next one is built.  It is swapped with `pop_` each generation.
+	 */
+	std::vector<Individual> spare_pop_;
+	/**
+	 * Arenas holding the nodes of the current generation, one per worker.
+	 * They are swapped with `spare_arenas_` along with `pop_`, and the
+	 * chunks of the retired generation are released and refilled.
+	 */
+	std::vector<std::unique_ptr<NodeArena>> arenas_;
+	/** Arenas holding the nodes of `spare_pop_`. */
+	std::vector<std::unique_ptr<NodeArena>> spare_arenas_;
+	std::vector<const MapDefinition*> maps_;
 	double mutation_rate_;
 	double nonterminal_crossover_rate_;
 	size_t tournament_size_;
 	double proportional_tournament_rate_;
+	bool batch_evaluation_;
+	bool linear_genome_;
+	bool shared_trees_;
+	FitnessCache *fitness_cache_;
+	uint64_t map_set_hash_; /**< `FitnessCache` key of `maps_`. */
+	size_t simplify_interval_;
+	ThreadPool *thread_pool_;
+	Rng rng_; /**< Generator every child's generator is split from. */
+	size_t generation_; /**< Number of calls to `Evolve()` so far. */
 
 	size_t largest_tree_;
 	size_t smallest_tree_;
 	size_t avg_tree_;
 	size_t total_nodes_;
 	size_t best_index_;
+	size_t elitism_count_; /**< Elites carried into the next generation. */
+	/** Positions in `pop_` of the elites, best first. */
+	std::vector<uint32_t> elites_;
+	/**
+	 * Fitness and tree size of each individual, by position, so selection,
+	 * ranking and the statistics read two dense arrays instead of every
+	 * `Individual`.  They are set by `SummarizeFitness()` and
+	 * `CalculateTreeSize()`.
+	 */
+	std::vector<double> fitnesses_;
+	std::vector<uint32_t> tree_sizes_;
+	/** Positions of the parents of each child, picked by `SelectParents()`. */
+	std::vector<uint32_t> parents_;
+	/** The draws of `SelectParents()`, kept to reuse their storage. */
+	std::vector<uint32_t> selection_draws_;
+	std::vector<uint8_t> fitness_based_;
+	/**
+	 * Number of individuals at the front of `pop_` whose scores are still
+	 * current, so the next `CalculateFitness()` doesn't simulate them.
+	 */
+	size_t scored_count_;
+	bool steady_state_;
+	/**
+	 * What the steady-state tasks share about one individual of `pop_`.
+	 * The individual is only read or replaced with `mutex` held, while its
+	 * fitness and tree size can be read for tournaments at any time.
+	 */
+	struct Slot {
+		std::mutex mutex;
+		std::atomic<double> fitness;
+		std::atomic<size_t> tree_size;
+	};
+	/** One slot per individual, once the population evolves steadily. */
+	std::unique_ptr<Slot[]> slots_;
+	/** The child each worker is making, in steady-state evolution. */
+	std::vector<Individual> offspring_;
 	double best_fitness_;
 	double worst_fitness_;
 	double avg_fitness_;
+	size_t steps_saved_;
+	size_t cache_hits_;
+	size_t simplified_nodes_;
+	/** Arena counts when the last generation started, by phase. */
+	uint64_t allocation_base_[NodeArena::kPhaseCount];
+	uint64_t free_base_[NodeArena::kPhaseCount];
+	uint64_t released_base_;
 
 	size_t best_weighted_index_;
 };
\ No newline at end of file
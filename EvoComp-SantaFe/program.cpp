@@ -0,0 +1,196 @@
+/*
+ * program.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "program.h"
+
+void Program::Compile(Node *root) {
+	instructions_.clear();
+	CompileNode(root);
+}
+void Program::Compile(const LinearGenome &genome) {
+	instructions_.clear();
+	if (genome.GetSize() != 0) {
+		CompileNode(genome, 0);
+	}
+}
+void Program::Compile(const SharedTree &tree) {
+	instructions_.clear();
+	if (tree.GetSize() != 0) {
+		CompileSubtree(tree.GetRoot());
+	}
+}
+template <typename Context>
+void Program::Run(Context *map) {
+	const Instruction *code = instructions_.data();
+	const size_t end = instructions_.size();
+	size_t pc = 0;
+
+	/* An empty program would never use an action and never terminate. */
+	if (end == 0 || map->IsTrailCleared()) {
+		return;
+	}
+	while (map->HasActionsRemaining()) {
+		if (pc == end) {
+			pc = 0;
+		}
+		/* Jumps only go forward, so a zero pc is the start of a pass. */
+		if (pc == 0 && map->IsRepeatingPass()) {
+			return;
+		}
+		switch (code[pc].op) {
+		case Opcode::kMoveForward:
+			map->MoveForward();
+			if (map->IsTrailCleared()) {
+				return;
+			}
+			++pc;
+			break;
+		case Opcode::kTurnLeft:
+			map->TurnLeft();
+			++pc;
+			break;
+		case Opcode::kTurnRight:
+			map->TurnRight();
+			++pc;
+			break;
+		case Opcode::kIfFoodAhead:
+			pc = map->IsFoodAhead() ? pc + 1 : code[pc].target;
+			break;
+		case Opcode::kJump:
+			pc = code[pc].target;
+			break;
+		}
+	}
+}
+template void Program::Run(EvaluationContext *map);
+template void Program::Run(EvaluationContext32x32 *map);
+size_t Program::GetInstructionCount() {
+	return instructions_.size();
+}
+size_t Program::GetReservedBytes() {
+	return instructions_.capacity() * sizeof(Instruction);
+}
+const Instruction* Program::GetInstructions() {
+	return instructions_.data();
+}
+void Program::CompileNode(Node *node) {
+	size_t branch;
+	size_t jump;
+
+	switch (node->GetOperator()) {
+	case OpType::kProg3:
+	case OpType::kProg2:
+		for (Node *child = node->GetChild(0); child;
+			 child = child->GetNextSibling()) {
+			CompileNode(child);
+		}
+		break;
+	case OpType::kIfFoodAhead:
+		/* Targets are patched once the length of each branch is known. */
+		branch = instructions_.size();
+		instructions_.push_back({ Opcode::kIfFoodAhead, 0 });
+		CompileNode(node->GetChild(0));
+		jump = instructions_.size();
+		instructions_.push_back({ Opcode::kJump, 0 });
+		instructions_[branch].target = static_cast<uint32_t>(jump + 1);
+		CompileNode(node->GetChild(1));
+		instructions_[jump].target =
+			static_cast<uint32_t>(instructions_.size());
+		break;
+	case OpType::kMoveForward:
+		instructions_.push_back({ Opcode::kMoveForward, 0 });
+		break;
+	case OpType::kTurnLeft:
+		instructions_.push_back({ Opcode::kTurnLeft, 0 });
+		break;
+	case OpType::kTurnRight:
+		instructions_.push_back({ Opcode::kTurnRight, 0 });
+		break;
+	}
+}
+void Program::CompileNode(const LinearGenome &genome, size_t position) {
+	size_t child = position + 1;
+	size_t branch;
+	size_t jump;
+
+	switch (genome.GetOperator(position)) {
+	case OpType::kProg3:
+	case OpType::kProg2:
+		for (size_t i = 0; i < LinearGenome::GetArity(
+				 genome.GetOperator(position)); ++i) {
+			CompileNode(genome, child);
+			child += genome.GetSubtreeSize(child);
+		}
+		break;
+	case OpType::kIfFoodAhead:
+		branch = instructions_.size();
+		instructions_.push_back({ Opcode::kIfFoodAhead, 0 });
+		CompileNode(genome, child);
+		jump = instructions_.size();
+		instructions_.push_back({ Opcode::kJump, 0 });
+		instructions_[branch].target = static_cast<uint32_t>(jump + 1);
+		CompileNode(genome, child + genome.GetSubtreeSize(child));
+		instructions_[jump].target =
+			static_cast<uint32_t>(instructions_.size());
+		break;
+	case OpType::kMoveForward:
+		instructions_.push_back({ Opcode::kMoveForward, 0 });
+		break;
+	case OpType::kTurnLeft:
+		instructions_.push_back({ Opcode::kTurnLeft, 0 });
+		break;
+	case OpType::kTurnRight:
+		instructions_.push_back({ Opcode::kTurnRight, 0 });
+		break;
+	}
+}
+void Program::CompileSubtree(uint32_t id) {
+	size_t branch;
+	size_t jump;
+
+	switch (SubtreeTable::GetOperator(id)) {
+	case OpType::kProg3:
+	case OpType::kProg2:
+		for (size_t i = 0; i < SubtreeTable::GetChildCount(id); ++i) {
+			CompileSubtree(SubtreeTable::GetChild(id, i));
+		}
+		break;
+	case OpType::kIfFoodAhead:
+		branch = instructions_.size();
+		instructions_.push_back({ Opcode::kIfFoodAhead, 0 });
+		CompileSubtree(SubtreeTable::GetChild(id, 0));
+		jump = instructions_.size();
+		instructions_.push_back({ Opcode::kJump, 0 });
+		instructions_[branch].target = static_cast<uint32_t>(jump + 1);
+		CompileSubtree(SubtreeTable::GetChild(id, 1));
+		instructions_[jump].target =
+			static_cast<uint32_t>(instructions_.size());
+		break;
+	case OpType::kMoveForward:
+		instructions_.push_back({ Opcode::kMoveForward, 0 });
+		break;
+	case OpType::kTurnLeft:
+		instructions_.push_back({ Opcode::kTurnLeft, 0 });
+		break;
+	case OpType::kTurnRight:
+		instructions_.push_back({ Opcode::kTurnRight, 0 });
+		break;
+	}
+}
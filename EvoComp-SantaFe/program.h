@@ -0,0 +1,112 @@
+/*
+ * program.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * Flat bytecode representation of a solution tree and the interpreter that
+ * runs it against an `EvaluationContext`.
+ *
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "linear_genome.h"
+#include "node.h"
+#include "shared_tree.h"
+#include "evaluation_context.h"
+
+/**
+ * @enum	Opcode
+ * The instructions understood by the `Program` interpreter.  The sequencing
+ * nonterminals (`kProg2` and `kProg3`) disappear during compilation because
+ * their children are simply laid out one after another.
+ */
+enum class Opcode : uint8_t {
+	kMoveForward,	/**< Move the ant forward one space. */
+	kTurnLeft,		/**< Turn the ant left. */
+	kTurnRight,		/**< Turn the ant right. */
+	kIfFoodAhead,	/**< Fall through if food is ahead, otherwise jump. */
+	kJump			/**< Unconditionally jump to the target. */
+};
+/**
+ * @struct	Instruction
+ * A single instruction of a compiled `Program`.
+ */
+struct Instruction {
+	Opcode op; /**< The operation to perform. */
+	uint32_t target; /**< Absolute jump target for the branching opcodes. */
+};
+/**
+ * @class	Program
+ * A solution tree compiled into a contiguous array of instructions.  The
+ * `kIfFoodAhead` nonterminal becomes a conditional jump over its first
+ * branch followed by an unconditional jump over its second branch, so the
+ * interpreter never recurses and never follows a pointer into the tree.
+ */
+class Program {
+public:
+	/**
+	 * Compile a solution tree, replacing any previously compiled program.
+	 *
+	 * @param[in]	root	Root node of the tree to compile.
+	 */
+	void Compile(Node *root);
+	/** Compile a tree stored as a `LinearGenome`. */
+	void Compile(const LinearGenome &genome);
+	/** Compile a tree stored as a `SharedTree`. */
+	void Compile(const SharedTree &tree);
+	/**
+	 * Run the program against a map until the ant is out of actions.  The
+	 * program restarts from the first instruction every time it falls off
+	 * the end, which mirrors `Individual::RunSimulation` reevaluating the
+	 * root of the tree.  The run stops early once the trail is cleared, or
+	 * once the context reports that a pass started in a repeating state,
+	 * since in either case the ant can't eat any more food.  The context is
+	 * expected to have already been reset.
+	 * Only `EvaluationContext` and `EvaluationContext32x32` are supported.
+	 *
+	 * @param[in]	*map	The context of the map the ant traverses.
+	 */
+	template <typename Context>
+	void Run(Context *map);
+	/** Exchange the compiled instructions with another program. */
+	void Swap(Program &other) noexcept {
+		instructions_.swap(other.instructions_);
+	}
+	/** Return the number of instructions in the compiled program. */
+	size_t GetInstructionCount();
+	/** Return the number of bytes held for instructions, used or not. */
+	size_t GetReservedBytes();
+	/** Return a pointer to the first instruction of the program. */
+	const Instruction* GetInstructions();
+private:
+	/**
+	 * Append the instructions for a node and its subtree.
+	 *
+	 * @param[in]	*node	The node to compile.
+	 */
+	void CompileNode(Node *node);
+	/** Append the instructions for the subtree at `position` of a genome. */
+	void CompileNode(const LinearGenome &genome, size_t position);
+	/** Append the instructions for a `SubtreeTable` subtree. */
+	void CompileSubtree(uint32_t id);
+	std::vector<Instruction> instructions_; /**< The compiled program. */
+};
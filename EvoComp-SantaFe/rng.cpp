@@ -0,0 +1,84 @@
+/*
+ * rng.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rng.h"
+#include <cmath> /* std::log */
+#include <cstring> /* std::memset */
+#include <random> /* std::random_device */
+#include "hash.h"
+
+namespace {
+/** Below this success rate `FillBernoulli()` skips over the failures. */
+const double kGeometricBernoulliRate = 0.125;
+/** Advance a SplitMix64 generator, used to expand seeds into full states. */
+uint64_t SplitMix64(uint64_t &x) {
+	uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+}
+
+Rng::Rng(uint64_t seed) : seed_(seed) {
+	/* SplitMix64 never gives the all zero state xoshiro can't leave. */
+	uint64_t x = seed;
+	for (uint64_t &word : state_) {
+		word = SplitMix64(x);
+	}
+}
+uint64_t Rng::GetRandomSeed() {
+	std::random_device rd;
+	return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+}
+Rng Rng::Split(uint64_t stream) const {
+	return Rng(HashCombine(seed_, stream));
+}
+void Rng::FillBounded(uint32_t bound, size_t count, uint32_t *out) {
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = NextBounded(bound);
+	}
+}
+void Rng::FillBernoulli(double p, size_t count, uint8_t *out) {
+	if (!(p > 0) || p >= kGeometricBernoulliRate) {
+		const uint64_t threshold = GetBernoulliThreshold(p);
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = (Next() >> 11) < threshold;
+		}
+		return;
+	}
+
+	/*
+	 * The number of failures before each success is geometric, so draw
+	 * that with one logarithm instead of drawing every trial.
+	 */
+	std::memset(out, 0, count);
+	const double log_failure = std::log1p(-p);
+	size_t i = 0;
+	for (;;) {
+		/* Uniform on (0, 1] so the logarithm is finite. */
+		double u = static_cast<double>((Next() >> 11) + 1) * kDoubleUnit;
+		double gap = std::floor(std::log(u) / log_failure);
+		if (gap >= static_cast<double>(count - i)) {
+			break;
+		}
+		i += static_cast<size_t>(gap);
+		out[i++] = 1;
+	}
+}
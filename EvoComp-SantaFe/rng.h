@@ -0,0 +1,147 @@
+/*
+ * rng.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class	Rng
+ * The random number generator every random decision of a run is drawn
+ * from.  It is a xoshiro256** generator: 32 bytes of state and a handful of
+ * shifts and multiplies per draw, against the 2.5KB of state of a
+ * `std::mt19937`.
+ *
+ * A generator is created from a 64-bit seed, and `Split()` derives an
+ * independent stream from that seed and a stream number.  Splitting only
+ * depends on the seed, not on how much has been drawn, so a child made on
+ * any thread in any order draws the same numbers given the same run seed.
+ *
+ * The class meets the standard's UniformRandomBitGenerator requirements so
+ * it can still be handed to `std::shuffle` and the standard distributions,
+ * but the members below are cheaper than constructing a distribution for
+ * every draw.
+ */
+class Rng {
+public:
+	typedef uint64_t result_type;
+	/** Create a generator whose state is expanded from `seed`. */
+	explicit Rng(uint64_t seed = 0);
+	/** Return a seed taken from `std::random_device`. */
+	static uint64_t GetRandomSeed();
+	/** Return the seed the generator was created with. */
+	uint64_t GetSeed() const {
+		return seed_;
+	}
+	/**
+	 * Return a generator for an independent stream of this one.  The same
+	 * seed and stream number always give the same stream.
+	 */
+	Rng Split(uint64_t stream) const;
+	static constexpr result_type min() {
+		return 0;
+	}
+	static constexpr result_type max() {
+		return UINT64_MAX;
+	}
+	result_type operator()() {
+		return Next();
+	}
+	/** Return the next 64 random bits. */
+	uint64_t Next() {
+		const uint64_t result = RotateLeft(state_[1] * 5, 7) * 9;
+		const uint64_t t = state_[1] << 17;
+		state_[2] ^= state_[0];
+		state_[3] ^= state_[1];
+		state_[1] ^= state_[2];
+		state_[0] ^= state_[3];
+		state_[2] ^= t;
+		state_[3] = RotateLeft(state_[3], 45);
+		return result;
+	}
+	/**
+	 * Return an integer uniformly drawn from [0, bound).  Uses Lemire's
+	 * multiply and shift, which only needs a division in the rare case the
+	 * draw lands in the biased region.
+	 *
+	 * @param[in]	bound	The number of possible values.  Must not be zero.
+	 */
+	uint32_t NextBounded(uint32_t bound) {
+		uint64_t m = (Next() >> 32) * bound;
+		uint32_t low = static_cast<uint32_t>(m);
+		if (low < bound) {
+			uint32_t threshold = static_cast<uint32_t>(-bound) % bound;
+			while (low < threshold) {
+				m = (Next() >> 32) * bound;
+				low = static_cast<uint32_t>(m);
+			}
+		}
+		return static_cast<uint32_t>(m >> 32);
+	}
+	/** Return a double uniformly drawn from [0, 1). */
+	double NextDouble() {
+		return static_cast<double>(Next() >> 11) * kDoubleUnit;
+	}
+	/** Return true with probability `p`. */
+	bool NextBernoulli(double p) {
+		return (Next() >> 11) < GetBernoulliThreshold(p);
+	}
+	/**
+	 * Fill `out` with `count` integers uniformly drawn from [0, bound).
+	 *
+	 * @param[in]	bound	The number of possible values.  Must not be zero.
+	 */
+	void FillBounded(uint32_t bound, size_t count, uint32_t *out);
+	/**
+	 * Fill `out` with the outcomes of `count` trials that each succeed with
+	 * probability `p`, one byte per trial.  For small `p` the gaps between
+	 * successes are drawn instead of every trial, so a low mutation rate
+	 * over a large tree only costs a few draws.
+	 */
+	void FillBernoulli(double p, size_t count, uint8_t *out);
+
+private:
+	/** 2^-53, the spacing of the doubles `NextDouble()` returns. */
+	static constexpr double kDoubleUnit = 1.0 / 9007199254740992.0;
+
+	static uint64_t RotateLeft(uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+	/**
+	 * Return the value that 53 random bits are compared against to succeed
+	 * with probability `p`.
+	 */
+	static uint64_t GetBernoulliThreshold(double p) {
+		if (!(p > 0)) {
+			return 0;
+		}
+		if (p >= 1) {
+			return UINT64_C(1) << 53;
+		}
+		return static_cast<uint64_t>(p * 9007199254740992.0);
+	}
+
+	uint64_t seed_;
+	uint64_t state_[4];
+};
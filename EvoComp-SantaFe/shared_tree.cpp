@@ -0,0 +1,376 @@
+/*
+ * shared_tree.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shared_tree.h"
+#include <cstdlib> /* exit, EXIT_FAILURE */
+#include <iostream> /* Logging/error reporting only */
+#include <utility> /* std::swap */
+#include "encoding.h"
+#include "linear_genome.h"
+
+SharedTree::SharedTree(const SharedTree &to_copy) : root_(to_copy.root_) {
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::AddReference(root_);
+	}
+}
+SharedTree::SharedTree(SharedTree &&to_move) noexcept :
+	root_(to_move.root_) {
+	to_move.root_ = SubtreeTable::kNullId;
+}
+SharedTree& SharedTree::operator=(const SharedTree &to_copy) {
+	/* Referencing the new root first makes self-assignment harmless. */
+	if (to_copy.root_ != SubtreeTable::kNullId) {
+		SubtreeTable::AddReference(to_copy.root_);
+	}
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::Release(root_);
+	}
+	root_ = to_copy.root_;
+	return *this;
+}
+SharedTree& SharedTree::operator=(SharedTree &&to_move) noexcept {
+	Swap(to_move);
+	return *this;
+}
+SharedTree::~SharedTree() {
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::Release(root_);
+	}
+}
+void SharedTree::Generate(size_t max_depth, bool full_tree, Rng &rng) {
+	uint32_t root = GenerateSubtree(0, max_depth, full_tree, rng);
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::Release(root_);
+	}
+	root_ = root;
+}
+void SharedTree::Mutate(double mutation_chance, size_t max_depth,
+						Rng &rng) {
+	/* One trial per node, drawn up front like `Individual::Mutate()`. */
+	static thread_local std::vector<uint8_t> mutations;
+	static thread_local std::vector<uint32_t> mutated;
+	mutations.resize(GetSize());
+	rng.FillBernoulli(mutation_chance, mutations.size(), mutations.data());
+	mutated.clear();
+	for (size_t i = 0; i < mutations.size(); ++i) {
+		if (mutations[i]) {
+			mutated.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	MutationPass pass = { &mutations, &mutated, 0, 0, mutation_chance,
+						  max_depth };
+	uint32_t root = MutateSubtree(root_, pass, 0, rng);
+	SubtreeTable::Release(root_);
+	root_ = root;
+}
+void SharedTree::Splice(size_t position, const SharedTree &donor,
+						size_t donor_position) {
+	uint32_t graft = donor.FindSubtree(donor_position);
+	uint32_t root;
+	if (position == 0) {
+		SubtreeTable::AddReference(graft);
+		root = graft;
+	} else {
+		root = GraftSubtree(root_, position, graft);
+	}
+	SubtreeTable::Release(root_);
+	root_ = root;
+}
+size_t SharedTree::SelectPosition(size_t countdown, bool nonterminal) const {
+	/* The same descent as `Node::SelectNode()`, tracking the position. */
+	uint32_t id = root_;
+	size_t position = 0;
+	while (true) {
+		bool matches =
+			nonterminal == (LinearGenome::GetArity(
+								SubtreeTable::GetOperator(id)) != 0);
+		if (matches) {
+			if (countdown == 0) {
+				return position;
+			}
+			--countdown;
+		}
+		size_t remaining = nonterminal
+			? SubtreeTable::GetNonterminalCount(id)
+			: SubtreeTable::GetTerminalCount(id);
+		if (matches) {
+			--remaining;
+		}
+		if (countdown >= remaining) {
+			std::cerr << "No node left to select!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		size_t from_end = remaining - countdown;
+		size_t passed = 0;
+		++position;
+		for (size_t i = 0;; ++i) {
+			uint32_t child = SubtreeTable::GetChild(id, i);
+			size_t count = nonterminal
+				? SubtreeTable::GetNonterminalCount(child)
+				: SubtreeTable::GetTerminalCount(child);
+			if (passed + count >= from_end) {
+				countdown = passed + count - from_end;
+				id = child;
+				break;
+			}
+			passed += count;
+			position += SubtreeTable::GetSize(child);
+		}
+	}
+}
+void SharedTree::CountNodes(size_t &term_count, size_t &nonterm_count) const {
+	term_count += SubtreeTable::GetTerminalCount(root_);
+	nonterm_count += SubtreeTable::GetNonterminalCount(root_);
+}
+uint64_t SharedTree::Hash() const {
+	return SubtreeTable::GetHash(root_);
+}
+Node* SharedTree::ToTree() const {
+	return BuildNode(root_);
+}
+void SharedTree::FromTree(Node *root) {
+	uint32_t id = InternNode(root);
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::Release(root_);
+	}
+	root_ = id;
+}
+void SharedTree::Encode(std::string &bytes) const {
+	EncodeSubtree(root_, bytes);
+}
+bool SharedTree::Decode(const std::string &bytes, size_t &position) {
+	uint32_t id = DecodeSubtree(bytes, position);
+	if (id == SubtreeTable::kNullId) {
+		return false;
+	}
+	if (root_ != SubtreeTable::kNullId) {
+		SubtreeTable::Release(root_);
+	}
+	root_ = id;
+	return true;
+}
+size_t SharedTree::GetSize() const {
+	return (root_ != SubtreeTable::kNullId) ? SubtreeTable::GetSize(root_)
+											: 0;
+}
+uint32_t SharedTree::GenerateSubtree(size_t cur_depth, size_t max_depth,
+									 bool full_tree, Rng &rng) {
+	OpType lower_bound, upper_bound;
+	if (full_tree) {
+		lower_bound = OpType::kProg3;
+		upper_bound = OpType::kIfFoodAhead;
+	} else {
+		lower_bound = OpType::kProg3;
+		upper_bound = OpType::kTurnRight;
+	}
+	if (cur_depth >= max_depth) {
+		lower_bound = OpType::kMoveForward;
+		upper_bound = OpType::kTurnRight;
+	}
+	OpType op = static_cast<OpType>(lower_bound +
+									rng.NextBounded(upper_bound -
+													lower_bound + 1));
+	uint32_t children[3];
+	size_t child_count = LinearGenome::GetArity(op);
+	for (size_t c = 0; c < child_count; ++c) {
+		children[c] = GenerateSubtree(cur_depth + 1, max_depth, full_tree,
+									  rng);
+	}
+	return SubtreeTable::Intern(op, children, child_count);
+}
+uint32_t SharedTree::MutateSubtree(uint32_t id, MutationPass &pass,
+								   size_t cur_depth, Rng &rng) {
+	const size_t kMinimumTreeIncrease = 3;
+	const std::vector<uint8_t> &mutations = *pass.mutations;
+	const std::vector<uint32_t> &mutated = *pass.mutated;
+
+	/* A subtree none of whose nodes mutates is visited in one step. */
+	size_t end = pass.next_visit + SubtreeTable::GetSize(id);
+	while (pass.next_mutated < mutated.size() &&
+		   mutated[pass.next_mutated] < pass.next_visit) {
+		++pass.next_mutated;
+	}
+	if (end <= mutations.size() && (pass.next_mutated == mutated.size() ||
+									mutated[pass.next_mutated] >= end)) {
+		pass.next_visit = end;
+		SubtreeTable::AddReference(id);
+		return id;
+	}
+
+	bool mutate;
+	if (pass.next_visit < mutations.size()) {
+		mutate = mutations[pass.next_visit] != 0;
+	} else {
+		mutate = rng.NextBernoulli(pass.mutation_chance);
+	}
+	++pass.next_visit;
+
+	OpType op = SubtreeTable::GetOperator(id);
+	if (mutate) {
+		OpType lower_bound, upper_bound;
+		if (LinearGenome::GetArity(op) == 0) {
+			lower_bound = OpType::kMoveForward;
+			upper_bound = OpType::kTurnRight;
+		} else {
+			lower_bound = OpType::kProg3;
+			upper_bound = OpType::kIfFoodAhead;
+		}
+		op = static_cast<OpType>(lower_bound + rng.NextBounded(
+			upper_bound - lower_bound + 1));
+		uint32_t children[3];
+		size_t child_count = LinearGenome::GetArity(op);
+		for (size_t c = 0; c < child_count; ++c) {
+			/* Determine max tree size */
+			size_t adjusted_depth = pass.max_depth;
+			if (adjusted_depth < cur_depth) {
+				adjusted_depth = cur_depth + kMinimumTreeIncrease;
+			}
+			children[c] = GenerateSubtree(cur_depth + 1, adjusted_depth,
+										  false, rng);
+		}
+		return SubtreeTable::Intern(op, children, child_count);
+	}
+
+	size_t child_count = SubtreeTable::GetChildCount(id);
+	std::vector<uint32_t> children(child_count);
+	bool changed = false;
+	for (size_t c = 0; c < child_count; ++c) {
+		uint32_t child = SubtreeTable::GetChild(id, c);
+		children[c] = MutateSubtree(child, pass, cur_depth + 1, rng);
+		if (children[c] != child) {
+			changed = true;
+		}
+	}
+	if (!changed) {
+		for (uint32_t child : children) {
+			SubtreeTable::Release(child);
+		}
+		SubtreeTable::AddReference(id);
+		return id;
+	}
+	return SubtreeTable::Intern(op, children.data(), child_count);
+}
+uint32_t SharedTree::GraftSubtree(uint32_t id, size_t position,
+								  uint32_t graft) {
+	size_t child_count = SubtreeTable::GetChildCount(id);
+	std::vector<uint32_t> children;
+	children.reserve(child_count + 1);
+	size_t remaining = position - 1;
+	size_t replaced = child_count;
+	for (size_t c = 0; c < child_count; ++c) {
+		uint32_t child = SubtreeTable::GetChild(id, c);
+		size_t size = SubtreeTable::GetSize(child);
+		if (replaced == child_count && remaining < size) {
+			replaced = c;
+			if (remaining == 0) {
+				SubtreeTable::AddReference(graft);
+				children.push_back(graft);
+			} else {
+				children.push_back(GraftSubtree(child, remaining, graft));
+			}
+		} else {
+			SubtreeTable::AddReference(child);
+			children.push_back(child);
+			if (replaced == child_count) {
+				remaining -= size;
+			}
+		}
+	}
+	if (replaced == child_count) {
+		std::cerr << "Invalid child selected (" << position << ")";
+		std::cerr << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	if (remaining == 0) {
+		/* As `Node::SetChild()` does, the graft is appended as well. */
+		SubtreeTable::AddReference(graft);
+		children.push_back(graft);
+	}
+	return SubtreeTable::Intern(SubtreeTable::GetOperator(id),
+								children.data(), children.size());
+}
+uint32_t SharedTree::FindSubtree(size_t position) const {
+	uint32_t id = root_;
+	while (position != 0) {
+		--position;
+		for (size_t c = 0;; ++c) {
+			uint32_t child = SubtreeTable::GetChild(id, c);
+			size_t size = SubtreeTable::GetSize(child);
+			if (position < size) {
+				id = child;
+				break;
+			}
+			position -= size;
+		}
+	}
+	return id;
+}
+Node* SharedTree::BuildNode(uint32_t id) {
+	Node *node = Node::Create();
+	node->op_ = SubtreeTable::GetOperator(id);
+	uint32_t *link = &node->first_child_;
+	for (size_t c = 0; c < SubtreeTable::GetChildCount(id); ++c) {
+		Node *built = BuildNode(SubtreeTable::GetChild(id, c));
+		*link = built->index_;
+		link = &built->next_sibling_;
+	}
+	node->UpdateCounts();
+	return node;
+}
+uint32_t SharedTree::InternNode(Node *node) {
+	std::vector<uint32_t> children;
+	for (Node *child = node->GetChild(0); child;
+		 child = child->GetNextSibling()) {
+		children.push_back(InternNode(child));
+	}
+	return SubtreeTable::Intern(node->GetOperator(), children.data(),
+								children.size());
+}
+void SharedTree::EncodeSubtree(uint32_t id, std::string &bytes) {
+	size_t child_count = SubtreeTable::GetChildCount(id);
+	AppendEncodedNode(bytes, SubtreeTable::GetOperator(id), child_count);
+	for (size_t c = 0; c < child_count; ++c) {
+		EncodeSubtree(SubtreeTable::GetChild(id, c), bytes);
+	}
+}
+uint32_t SharedTree::DecodeSubtree(const std::string &bytes,
+								   size_t &position) {
+	OpType op;
+	size_t child_count;
+	/* Every child takes at least a byte, which bounds a corrupt count. */
+	if (!ReadEncodedNode(bytes, position, op, child_count) ||
+		child_count > bytes.size() - position) {
+		return SubtreeTable::kNullId;
+	}
+	std::vector<uint32_t> children;
+	children.reserve(child_count);
+	for (size_t c = 0; c < child_count; ++c) {
+		uint32_t child = DecodeSubtree(bytes, position);
+		if (child == SubtreeTable::kNullId) {
+			for (uint32_t decoded : children) {
+				SubtreeTable::Release(decoded);
+			}
+			return SubtreeTable::kNullId;
+		}
+		children.push_back(child);
+	}
+	return SubtreeTable::Intern(op, children.data(), children.size());
+}
@@ -0,0 +1,168 @@
+/*
+ * shared_tree.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "node.h"
+#include "operator_types.h"
+#include "rng.h"
+#include "subtree_table.h"
+
+/**
+ * @class	SharedTree
+ * A solution tree whose subtrees are interned in the `SubtreeTable`, so
+ * identical subtrees are stored once however many trees contain them.  The
+ * tree is immutable: copying one is a reference count increment, and
+ * crossover and mutation build new entries only for the path from the root
+ * down to each change, sharing everything else with the old tree.
+ *
+ * The tree has exactly the shape of the equivalent `Node` tree, including
+ * the extra children crossover links onto a node, and every operation
+ * draws from the generator in the same order as the `Node` version.  Given
+ * the same seed, a run with shared trees evolves the same individuals as a
+ * run with `Node` trees.
+ */
+class SharedTree {
+public:
+	/** Create a tree without any nodes, only to be assigned over. */
+	SharedTree() : root_(SubtreeTable::kNullId) {}
+	/** Share the nodes of `to_copy`. */
+	SharedTree(const SharedTree &to_copy);
+	/** Take over the nodes of `to_move`, leaving it without any. */
+	SharedTree(SharedTree &&to_move) noexcept;
+	/** Share the nodes of `to_copy` in place of the current ones. */
+	SharedTree& operator=(const SharedTree &to_copy);
+	/** Exchange the nodes with `to_move`. */
+	SharedTree& operator=(SharedTree &&to_move) noexcept;
+	/** Release the reference to the root. */
+	~SharedTree();
+	/**
+	 * Replace the tree with a random tree, drawn the same way as
+	 * `Node::GenerateTree()`.
+	 *
+	 * @param[in]	max_depth	Depth at which only terminals are drawn.
+	 * @param[in]	full_tree	Only draw nonterminals until `max_depth`.
+	 * @param[in]	rng			The generator to draw operators from.
+	 */
+	void Generate(size_t max_depth, bool full_tree, Rng &rng);
+	/**
+	 * Give each node a `mutation_chance` chance of changing its operator to
+	 * another of the same kind, the same way as `Individual::Mutate()` does
+	 * for a `Node` tree.  Subtrees without a mutation are skipped whole by
+	 * their size, so only the paths down to the mutations are visited.
+	 *
+	 * @param[in]	mutation_chance		The chance that a node mutates.
+	 * @param[in]	max_depth			Max tree depth to help curb code
+	 *									growth.
+	 * @param[in]	rng					The generator to draw from.
+	 */
+	void Mutate(double mutation_chance, size_t max_depth, Rng &rng);
+	/**
+	 * Replace the subtree at prefix-order `position` with the subtree of
+	 * `donor` at `donor_position`, the same way as crossover does for a
+	 * `Node` tree: unless it replaces the root, the donated subtree is also
+	 * appended as an extra child of the parent.  `donor` may be this tree.
+	 */
+	void Splice(size_t position, const SharedTree &donor,
+				size_t donor_position);
+	/**
+	 * Return the prefix-order position of the node `Node::SelectNode()`
+	 * would select with the same `countdown` and `nonterminal`.
+	 */
+	size_t SelectPosition(size_t countdown, bool nonterminal) const;
+	/** Count the terminal and nonterminal nodes. */
+	void CountNodes(size_t &term_count, size_t &nonterm_count) const;
+	/** Return the same structural hash as `Node::Hash()` on the tree. */
+	uint64_t Hash() const;
+	/** Build the tree in the current `NodeArena`. */
+	Node* ToTree() const;
+	/** Replace the tree with the one under `root`, extra children and all. */
+	void FromTree(Node *root);
+	/**
+	 * Append the nodes in prefix order to `bytes`, each with its number of
+	 * children, in the encoding of `encoding.h`.
+	 */
+	void Encode(std::string &bytes) const;
+	/**
+	 * Replace the tree with one written by `Encode()`, read from `bytes`
+	 * at `position`, and move `position` past it.
+	 *
+	 * @return	False, leaving the tree as it was, if the tree isn't valid.
+	 */
+	bool Decode(const std::string &bytes, size_t &position);
+	/** Exchange the nodes with another tree. */
+	void Swap(SharedTree &other) noexcept {
+		std::swap(root_, other.root_);
+	}
+	/** Return the `SubtreeTable` id of the root. */
+	uint32_t GetRoot() const {
+		return root_;
+	}
+	/** Return the number of nodes. */
+	size_t GetSize() const;
+
+private:
+	/** Where `Mutate()` is in its pass over the tree. */
+	struct MutationPass {
+		const std::vector<uint8_t> *mutations; /**< Draws made up front. */
+		const std::vector<uint32_t> *mutated; /**< Visits that mutate. */
+		size_t next_mutated; /**< First entry of `mutated` not passed. */
+		size_t next_visit; /**< Number of nodes visited so far. */
+		double mutation_chance;
+		size_t max_depth;
+	};
+
+	/**
+	 * Return a new random subtree, drawn the same way as
+	 * `Node::GenerateTree()`.
+	 */
+	static uint32_t GenerateSubtree(size_t cur_depth, size_t max_depth,
+									bool full_tree, Rng &rng);
+	/** Return the subtree `id` after the mutations of its nodes. */
+	static uint32_t MutateSubtree(uint32_t id, MutationPass &pass,
+								  size_t cur_depth, Rng &rng);
+	/**
+	 * Return the subtree `id` with the node at prefix-order `position`,
+	 * which isn't the root, replaced by `graft` as `Splice()` does.
+	 */
+	static uint32_t GraftSubtree(uint32_t id, size_t position,
+								 uint32_t graft);
+	/** Return the id of the subtree at prefix-order `position`. */
+	uint32_t FindSubtree(size_t position) const;
+	/** Build the tree for a subtree. */
+	static Node* BuildNode(uint32_t id);
+	/** Return the subtree for the tree under `node`. */
+	static uint32_t InternNode(Node *node);
+	/** Append the subtree to `bytes` for `Encode()`. */
+	static void EncodeSubtree(uint32_t id, std::string &bytes);
+	/**
+	 * Read a subtree for `Decode()`, returning `SubtreeTable::kNullId` if
+	 * it isn't valid.
+	 */
+	static uint32_t DecodeSubtree(const std::string &bytes, size_t &position);
+
+	uint32_t root_; /**< Reference to the root, unless `kNullId`. */
+};
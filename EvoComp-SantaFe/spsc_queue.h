@@ -0,0 +1,100 @@
+/*
+ * spsc_queue.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * @class	SpscQueue
+ * A bounded first-in first-out queue between exactly one producer thread
+ * and one consumer thread that never locks.  Each side only writes its own
+ * end of the ring, and publishes it with a release store that the other
+ * side reads with an acquire load.  Items are swapped in and out of the
+ * ring rather than copied, so the storage of an item, such as the buffer of
+ * a `std::vector`, goes back to whoever pushes next instead of being freed.
+ */
+template <typename T>
+class SpscQueue {
+public:
+	/**
+	 * Create an empty queue.
+	 *
+	 * @param[in]	capacity	The most items the queue holds at once,
+	 *							rounded up to a power of two.
+	 */
+	explicit SpscQueue(size_t capacity) : head_(0), tail_(0) {
+		size_t size = 1;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		slots_.resize(size);
+		mask_ = size - 1;
+	}
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+	/**
+	 * Swap `item` into the back of the queue, unless the queue is full.
+	 * Only the producer may call this.
+	 *
+	 * @return	Whether the item was pushed.
+	 */
+	bool TryPush(T &item) {
+		size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) > mask_) {
+			return false;
+		}
+		std::swap(slots_[tail & mask_], item);
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	/**
+	 * Swap the front of the queue into `item`, unless the queue is empty.
+	 * Only the consumer may call this.
+	 *
+	 * @return	Whether an item was popped.
+	 */
+	bool TryPop(T &item) {
+		size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire)) {
+			return false;
+		}
+		std::swap(slots_[head & mask_], item);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	/** Keeps the two ends of the queue on separate cache lines. */
+	static const size_t kCacheLineSize = 64;
+
+	std::vector<T> slots_;
+	size_t mask_; /**< Position of an item in `slots_` from its number. */
+	char head_padding_[kCacheLineSize];
+	std::atomic<size_t> head_; /**< Number of items popped so far. */
+	char tail_padding_[kCacheLineSize];
+	std::atomic<size_t> tail_; /**< Number of items pushed so far. */
+};
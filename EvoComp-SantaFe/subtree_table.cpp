@@ -0,0 +1,199 @@
+/*
+ * subtree_table.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "subtree_table.h"
+#include <algorithm> /* std::equal */
+#include <cstdlib> /* exit, EXIT_FAILURE */
+#include <iostream> /* Logging/error reporting only */
+#include "hash.h"
+
+const uint32_t SubtreeTable::kNullId;
+SubtreeTable::Shard SubtreeTable::shards_[SubtreeTable::kShardCount];
+SubtreeTable::Entry *SubtreeTable::chunk_table_[SubtreeTable::kMaxChunks];
+uint32_t SubtreeTable::chunk_count_ = 1;
+std::mutex SubtreeTable::chunk_table_mutex_;
+
+uint32_t SubtreeTable::Intern(OpType op, const uint32_t *children,
+							  size_t child_count) {
+	uint64_t hash = HashCombine(0, static_cast<uint64_t>(op));
+	uint32_t terminal_count = 0;
+	uint32_t nonterminal_count = 0;
+	uint16_t height = 0;
+	if (op == OpType::kProg3 || op == OpType::kProg2 ||
+		op == OpType::kIfFoodAhead) {
+		nonterminal_count = 1;
+	} else {
+		terminal_count = 1;
+	}
+	for (size_t i = 0; i < child_count; ++i) {
+		const Entry &child = At(children[i]);
+		hash = HashCombine(hash, child.hash);
+		terminal_count += child.terminal_count;
+		nonterminal_count += child.nonterminal_count;
+		if (child.height >= height) {
+			height = child.height + 1;
+		}
+	}
+
+	Shard &shard = GetShard(hash);
+	uint32_t found = kNullId;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if (!shard.buckets.empty()) {
+			uint32_t id = shard.buckets[GetBucket(hash, shard.buckets.size())];
+			for (; id != kNullId; id = At(id).next_in_bucket) {
+				Entry &entry = At(id);
+				if (entry.hash != hash || entry.op != op ||
+					entry.children.size() != child_count ||
+					!std::equal(children, children + child_count,
+								entry.children.begin())) {
+					continue;
+				}
+				/* An entry losing its last reference is as good as gone. */
+				uint32_t references = entry.references.load();
+				while (references != 0 &&
+					   !entry.references.compare_exchange_weak(
+						   references, references + 1)) {}
+				if (references != 0) {
+					found = id;
+					break;
+				}
+			}
+		}
+		if (found == kNullId) {
+			found = AllocateEntry(shard);
+			Entry &entry = At(found);
+			entry.hash = hash;
+			entry.references.store(1);
+			entry.terminal_count = terminal_count;
+			entry.nonterminal_count = nonterminal_count;
+			entry.height = height;
+			entry.op = op;
+			entry.children.assign(children, children + child_count);
+			if (shard.entry_count >= shard.buckets.size()) {
+				Grow(shard);
+			}
+			size_t bucket = GetBucket(hash, shard.buckets.size());
+			entry.next_in_bucket = shard.buckets[bucket];
+			shard.buckets[bucket] = found;
+			++shard.entry_count;
+			return found;
+		}
+	}
+	/* The existing entry already holds its own references to the children. */
+	for (size_t i = 0; i < child_count; ++i) {
+		Release(children[i]);
+	}
+	return found;
+}
+void SubtreeTable::AddReference(uint32_t id) {
+	At(id).references.fetch_add(1);
+}
+void SubtreeTable::Release(uint32_t id) {
+	if (At(id).references.fetch_sub(1) != 1) {
+		return;
+	}
+	/* Removing an entry releases its children, which may go in turn. */
+	static thread_local std::vector<uint32_t> removed;
+	removed.assign(1, id);
+	while (!removed.empty()) {
+		id = removed.back();
+		removed.pop_back();
+		Entry &entry = At(id);
+		Shard &shard = GetShard(entry.hash);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		uint32_t *link =
+			&shard.buckets[GetBucket(entry.hash, shard.buckets.size())];
+		while (*link != id) {
+			link = &At(*link).next_in_bucket;
+		}
+		*link = entry.next_in_bucket;
+		for (uint32_t child : entry.children) {
+			if (At(child).references.fetch_sub(1) == 1) {
+				removed.push_back(child);
+			}
+		}
+		if (entry.children.capacity() > kKeptChildCapacity) {
+			std::vector<uint32_t>().swap(entry.children);
+		} else {
+			entry.children.clear();
+		}
+		entry.next_in_bucket = shard.free_list;
+		shard.free_list = id;
+		--shard.entry_count;
+	}
+}
+size_t SubtreeTable::GetEntryCount() {
+	size_t count = 0;
+	for (Shard &shard : shards_) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		count += shard.entry_count;
+	}
+	return count;
+}
+size_t SubtreeTable::GetReservedBytes() {
+	std::lock_guard<std::mutex> lock(chunk_table_mutex_);
+	size_t bytes = (chunk_count_ - 1) * (kEntryMask + 1) * sizeof(Entry);
+	for (uint32_t chunk = 1; chunk < chunk_count_; ++chunk) {
+		for (uint32_t i = 0; i <= kEntryMask; ++i) {
+			bytes += chunk_table_[chunk][i].children.capacity() *
+					 sizeof(uint32_t);
+		}
+	}
+	for (Shard &shard : shards_) {
+		bytes += shard.buckets.capacity() * sizeof(uint32_t);
+	}
+	return bytes;
+}
+uint32_t SubtreeTable::AllocateEntry(Shard &shard) {
+	if (shard.free_list != kNullId) {
+		uint32_t id = shard.free_list;
+		shard.free_list = At(id).next_in_bucket;
+		return id;
+	}
+	if (shard.next == shard.end) {
+		/* Chunks are never given back, since entries are reused instead. */
+		std::lock_guard<std::mutex> lock(chunk_table_mutex_);
+		if (chunk_count_ >= kMaxChunks - 1) {
+			std::cerr << "Out of subtree table entries!" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		uint32_t chunk = chunk_count_++;
+		chunk_table_[chunk] = new Entry[kEntryMask + 1];
+		shard.next = chunk << kChunkShift;
+		shard.end = shard.next + kEntryMask + 1;
+	}
+	return shard.next++;
+}
+void SubtreeTable::Grow(Shard &shard) {
+	std::vector<uint32_t> buckets(
+		shard.buckets.empty() ? 64 : shard.buckets.size() * 2, kNullId);
+	for (uint32_t head : shard.buckets) {
+		while (head != kNullId) {
+			Entry &entry = At(head);
+			uint32_t next = entry.next_in_bucket;
+			size_t bucket = GetBucket(entry.hash, buckets.size());
+			entry.next_in_bucket = buckets[bucket];
+			buckets[bucket] = head;
+			head = next;
+		}
+	}
+	shard.buckets.swap(buckets);
+}
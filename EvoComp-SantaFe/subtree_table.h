@@ -0,0 +1,167 @@
+/*
+ * subtree_table.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "operator_types.h"
+
+/**
+ * @class	SubtreeTable
+ * The process-wide table of interned subtrees behind `SharedTree`.  Every
+ * distinct subtree is stored once, as its operator and the ids of its
+ * children, so identical subtrees anywhere in any population are the same
+ * entry.  An entry is never changed once it is added; a tree is changed by
+ * interning new entries for the path down to the change.
+ *
+ * Entries are reference counted.  Each child link and each `SharedTree`
+ * holds a reference, and an entry is removed, releasing its children, when
+ * its last reference goes.  Every function is safe to call from any thread.
+ * The entries are split over shards by hash, each with its own lock, and
+ * reading an entry that the caller holds a reference to takes no lock.
+ */
+class SubtreeTable {
+public:
+	/** The id of no subtree at all. */
+	static const uint32_t kNullId = 0;
+
+	/**
+	 * Return the id of the subtree with operator `op` and the given
+	 * children, adding it to the table if it isn't there yet.  The caller's
+	 * references to the children are handed over, and the caller gets a
+	 * reference to the subtree.
+	 */
+	static uint32_t Intern(OpType op, const uint32_t *children,
+						   size_t child_count);
+	/** Add a reference to a subtree the caller already holds one to. */
+	static void AddReference(uint32_t id);
+	/**
+	 * Drop a reference to a subtree, removing it and releasing its children
+	 * if it was the last one.
+	 */
+	static void Release(uint32_t id);
+	/** Returns the operator at the root of the subtree. */
+	static OpType GetOperator(uint32_t id) {
+		return At(id).op;
+	}
+	/** Returns the number of children of the root of the subtree. */
+	static size_t GetChildCount(uint32_t id) {
+		return At(id).children.size();
+	}
+	/** Returns the id of a child of the root of the subtree. */
+	static uint32_t GetChild(uint32_t id, size_t child_number) {
+		return At(id).children[child_number];
+	}
+	/** Returns the number of terminal nodes in the subtree. */
+	static size_t GetTerminalCount(uint32_t id) {
+		return At(id).terminal_count;
+	}
+	/** Returns the number of nonterminal nodes in the subtree. */
+	static size_t GetNonterminalCount(uint32_t id) {
+		return At(id).nonterminal_count;
+	}
+	/** Returns the number of nodes in the subtree. */
+	static size_t GetSize(uint32_t id) {
+		return At(id).terminal_count + At(id).nonterminal_count;
+	}
+	/** Returns the height of the subtree, zero for a single node. */
+	static size_t GetHeight(uint32_t id) {
+		return At(id).height;
+	}
+	/** Returns the same structural hash as `Node::Hash()`. */
+	static uint64_t GetHash(uint32_t id) {
+		return At(id).hash;
+	}
+	/** Returns the number of distinct subtrees in the table. */
+	static size_t GetEntryCount();
+	/**
+	 * Return the number of bytes the table has taken from the system for
+	 * its entries, their children and its buckets.  It mustn't be called
+	 * while another thread may be using the table.
+	 */
+	static size_t GetReservedBytes();
+
+private:
+	/** An interned subtree. */
+	struct Entry {
+		uint64_t hash;
+		std::atomic<uint32_t> references;
+		uint32_t terminal_count;
+		uint32_t nonterminal_count;
+		uint32_t next_in_bucket; /**< Next entry with the same bucket. */
+		uint16_t height;
+		OpType op;
+		std::vector<uint32_t> children;
+	};
+	/** The entries whose hash selects the same lock. */
+	struct Shard {
+		std::mutex mutex;
+		std::vector<uint32_t> buckets; /**< Heads of the hash chains. */
+		size_t entry_count;
+		uint32_t free_list; /**< Removed entries, through `next_in_bucket`. */
+		uint32_t next; /**< Next unused entry of the newest chunk. */
+		uint32_t end; /**< One past the last entry of the newest chunk. */
+	};
+
+	/** Number of shards, a power of two. */
+	static const size_t kShardCount = 16;
+	/**
+	 * Most children a removed entry keeps room for.  Crossover can give a
+	 * node any number of children, and room kept for those would never be
+	 * given back, since entries are reused rather than freed.
+	 */
+	static const size_t kKeptChildCapacity = 3;
+	/** A chunk holds 2 to the power of this many entries. */
+	static const uint32_t kChunkShift = 10;
+	/** Mask for the position of an entry within its chunk. */
+	static const uint32_t kEntryMask = (1u << kChunkShift) - 1;
+	/** Number of entries in the chunk table. */
+	static const size_t kMaxChunks = size_t(1) << (32 - kChunkShift);
+
+	static Entry& At(uint32_t id) {
+		return chunk_table_[id >> kChunkShift][id & kEntryMask];
+	}
+	static Shard& GetShard(uint64_t hash) {
+		return shards_[hash & (kShardCount - 1)];
+	}
+	/** Return the bucket of `hash` in a shard with `bucket_count` buckets. */
+	static size_t GetBucket(uint64_t hash, size_t bucket_count) {
+		return (hash >> 32) & (bucket_count - 1);
+	}
+	/** Return an unused entry of a shard.  Its lock has to be held. */
+	static uint32_t AllocateEntry(Shard &shard);
+	/** Double the number of buckets of a shard.  Its lock has to be held. */
+	static void Grow(Shard &shard);
+
+	static Shard shards_[kShardCount];
+	/** Chunks of entries by number.  Chunk 0 is never used. */
+	static Entry *chunk_table_[kMaxChunks];
+	/** Number of chunk table entries handed out so far. */
+	static uint32_t chunk_count_;
+	/** Guards `chunk_count_`. */
+	static std::mutex chunk_table_mutex_;
+};
@@ -0,0 +1,126 @@
+/*
+ * thread_pool.cpp
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t thread_count) :
+	thread_count_(thread_count), task_(nullptr), batch_(0), busy_(0),
+	stopping_(false) {
+	if (thread_count_ == 0) {
+		thread_count_ = std::thread::hardware_concurrency();
+	}
+	if (thread_count_ == 0) {
+		thread_count_ = 1;
+	}
+	for (size_t i = 0; i < thread_count_; ++i) {
+		queues_.emplace_back(new WorkQueue);
+	}
+	for (size_t i = 1; i < thread_count_; ++i) {
+		threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	start_.notify_all();
+	for (std::thread &thread : threads_) {
+		thread.join();
+	}
+}
+size_t ThreadPool::GetThreadCount() {
+	return thread_count_;
+}
+void ThreadPool::Run(size_t task_count, const Task &task) {
+	if (threads_.empty()) {
+		for (size_t i = 0; i < task_count; ++i) {
+			task(0, i);
+		}
+		return;
+	}
+	for (size_t i = 0; i < task_count; ++i) {
+		WorkQueue &queue = *queues_[i % thread_count_];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(i);
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		task_ = &task;
+		busy_ = threads_.size();
+		++batch_;
+	}
+	start_.notify_all();
+	Work(0);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return busy_ == 0; });
+	task_ = nullptr;
+}
+void ThreadPool::WorkerLoop(size_t worker) {
+	size_t seen_batch = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [this, seen_batch] {
+				return stopping_ || batch_ != seen_batch;
+			});
+			if (stopping_) {
+				return;
+			}
+			seen_batch = batch_;
+		}
+		Work(worker);
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--busy_ == 0) {
+				done_.notify_one();
+			}
+		}
+	}
+}
+void ThreadPool::Work(size_t worker) {
+	size_t task;
+	while (PopTask(worker, task) || StealTask(worker, task)) {
+		(*task_)(worker, task);
+	}
+}
+bool ThreadPool::PopTask(size_t worker, size_t &task) {
+	WorkQueue &queue = *queues_[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = queue.tasks.front();
+	queue.tasks.pop_front();
+	return true;
+}
+bool ThreadPool::StealTask(size_t worker, size_t &task) {
+	for (size_t i = 1; i < thread_count_; ++i) {
+		WorkQueue &queue = *queues_[(worker + i) % thread_count_];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,96 @@
+/*
+ * thread_pool.h
+ * Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+ *
+ * This file is part of EvoComp-SantaFe
+ *
+ * EvoComp-SantaFe is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * EvoComp-SantaFe is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @file
+ * @date 16 October 2026
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class	ThreadPool
+ * A fixed set of worker threads that stay alive for the whole run and are
+ * handed batches of numbered tasks.  Each worker has its own queue; the
+ * tasks of a batch are dealt out to the queues in order, so if the caller
+ * numbers the most expensive tasks first, every worker starts on one of
+ * them.  A worker runs the tasks of its own queue from the front and, once
+ * that is empty, steals from the back of the other queues.
+ *
+ * The thread calling `Run()` takes part as worker zero, so a pool of one
+ * thread runs everything inline without starting any threads.
+ */
+class ThreadPool {
+public:
+	/**
+	 * A task of a batch.  It is given the number of the worker running it,
+	 * which can be used to index per-worker state, and its task number.
+	 */
+	typedef std::function<void(size_t worker, size_t task)> Task;
+	/**
+	 * Start the worker threads.
+	 *
+	 * @param[in]	thread_count	Number of workers, including the calling
+	 *								thread.  Zero uses one per hardware
+	 *								thread.
+	 */
+	explicit ThreadPool(size_t thread_count);
+	/** Stop and join the worker threads. */
+	~ThreadPool();
+	/** Return the number of workers, including the calling thread. */
+	size_t GetThreadCount();
+	/**
+	 * Run `task` once for each task number below `task_count` and wait for
+	 * all of them to finish.  Tasks may run in any order and at the same
+	 * time, so they must only write to state owned by their task or worker.
+	 */
+	void Run(size_t task_count, const Task &task);
+private:
+	/** The queue of task numbers belonging to one worker. */
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<size_t> tasks;
+	};
+	/** Wait for batches and work on them until the pool is destroyed. */
+	void WorkerLoop(size_t worker);
+	/** Run tasks of the current batch until none are left anywhere. */
+	void Work(size_t worker);
+	/** Take the next task from the front of the worker's own queue. */
+	bool PopTask(size_t worker, size_t &task);
+	/** Take a task from the back of another worker's queue. */
+	bool StealTask(size_t worker, size_t &task);
+
+	size_t thread_count_;
+	std::vector<std::thread> threads_;
+	std::vector<std::unique_ptr<WorkQueue>> queues_;
+	std::mutex mutex_; /**< Guards everything below. */
+	std::condition_variable start_;
+	std::condition_variable done_;
+	const Task *task_; /**< The task of the current batch. */
+	size_t batch_; /**< Incremented every time a batch starts. */
+	size_t busy_; /**< Worker threads still working on the batch. */
+	bool stopping_;
+};
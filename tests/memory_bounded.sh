@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+# memory_bounded.sh
+# Copyright (C) 2015 Chris Waltrip <walt2178@vandals.uidaho.edu>
+#
+# This file is part of EvoComp-SantaFe
+#
+# EvoComp-SantaFe is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# EvoComp-SantaFe is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with EvoComp-SantaFe.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Checks that a long run doesn't leak, using the memory usage file (-M).
+#
+# Usage: memory_bounded.sh <santafe> [seed]
+#
+# Each representation is evolved for 3000 generations with bloat held down
+# (a low -x, simplifying every generation), so that any steady growth is a
+# leak rather than the programs getting bigger.  A run fails if
+#
+#  - the tree nodes and subtree table entries alive after a generation are
+#    more than 4 times the nodes of the population, which holds them all
+#    twice over at most (the population and the one it was bred from), or
+#  - the resident set size over the second half of the run grows more than
+#    25% past the most it reached between generation 500 and the midpoint.
+
+if [ $# -lt 1 ]; then
+	echo "Usage: $0 <santafe> [seed]" >&2
+	exit 2
+fi
+SANTAFE=$1
+SEED=${2:-11}
+GENERATIONS=3000
+POPULATION=200
+WORK=$(mktemp -d) || exit 2
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+check() {
+	name=$1
+	shift
+	if ! "$SANTAFE" -I classic:muir -g $GENERATIONS -p $POPULATION \
+			-e "$SEED" -x 2 -s 1 -m 0.1 -O "$WORK/out.csv" \
+			-M "$WORK/memory.csv" "$@" > /dev/null 2>&1; then
+		echo "FAIL $name: santafe exited with an error"
+		failed=1
+		return
+	fi
+	# The row of out.csv for generation g is line g, since generation 0
+	# isn't written to it.
+	if awk -F, -v name="$name" -v population=$POPULATION \
+			-v generations=$GENERATIONS '
+		NR == FNR {
+			size[FNR] = $4
+			next
+		}
+		FNR == 1 {
+			for (i = 1; i <= NF; ++i) {
+				column[$i] = i
+			}
+			next
+		}
+		$column["population"] != 0 {
+			next
+		}
+		{
+			g = $column["generation"]
+			live = $column["live_nodes"] + $column["subtrees"]
+			rss = $column["rss_bytes"]
+		}
+		g >= 2 {
+			nodes = size[g] > size[g - 1] ? size[g] : size[g - 1]
+			limit = 4 * population * (nodes + 1)
+			if (live > limit) {
+				printf "FAIL %s: %d nodes alive after generation %d, " \
+					   "limit %d\n", name, live, g, limit
+				leaked = 1
+				exit 1
+			}
+		}
+		g >= 500 && g <= generations / 2 && rss > early {
+			early = rss
+		}
+		g > generations / 2 && rss > late {
+			late = rss
+		}
+		END {
+			if (leaked) {
+				exit 1
+			}
+			if (late > early * 1.25) {
+				printf "FAIL %s: resident set grew from %d to %d bytes\n",
+					   name, early, late
+				exit 1
+			}
+			printf "ok %s: peak resident set %d then %d bytes\n",
+				   name, early, late
+		}' "$WORK/out.csv" "$WORK/memory.csv"; then
+		:
+	else
+		failed=1
+	fi
+}
+
+check tree
+check linear -l
+check shared -u
+exit $failed